@@ -0,0 +1,365 @@
+// Microbenchmarks and throughput regression checks. Every benchmark is run for a number of
+// samples of at least --min-seconds each and the median rate is reported, so one noisy sample
+// doesn't move the result. Results are written as JSON; with a baseline file, any benchmark
+// whose rate fell more than --threshold below the baseline's fails the run (exit code 1).
+//
+// usage: benchmark [--quick] [--filter TEXT] [--samples N] [--min-seconds S]
+//                  [--out FILE] [--baseline FILE] [--threshold FRACTION] [--save-baseline FILE]
+//   Defaults: --out benchmark.json --baseline Benchmark/baseline.json --threshold 0.10
+//   A missing baseline file only skips the comparison.
+
+#include <ChessBot.h>
+#include <NeuralNetwork.h>
+#include <Position.h>
+#include <RandomPlayout.h>
+#include <SelfPlay.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+struct BenchOptions {
+    std::string filter;
+    size_t samples = 5;
+    double minSeconds = 0.3;
+    std::string outPath = "benchmark.json";
+    std::string baselinePath = "Benchmark/baseline.json";
+    std::string saveBaselinePath;
+    double threshold = 0.10;
+};
+
+struct BenchResult {
+    std::string name;
+    std::string unit;       // what one counted item is, e.g. "matmul" or "game"
+    double perSecond = 0.0; // median over samples; higher is better
+    double minPerSecond = 0.0;
+    double maxPerSecond = 0.0;
+    uint64_t items = 0;     // items counted over all samples
+};
+
+// Keeps results observable so the optimizer can't drop the benchmarked work
+volatile float benchSink = 0.f;
+
+// body runs one batch of work and returns how many items it did
+BenchResult measure(const BenchOptions& options, const std::string& name, const std::string& unit,
+                    const std::function<uint64_t()>& body) {
+    BenchResult result;
+    result.name = name;
+    result.unit = unit;
+    body(); // warm caches and allocators
+
+    std::vector<double> rates;
+    for (size_t sample = 0; sample < options.samples; ++sample) {
+        uint64_t items = 0;
+        auto start = std::chrono::steady_clock::now();
+        double seconds = 0.0;
+        do {
+            items += body();
+            seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        } while (seconds < options.minSeconds);
+        rates.push_back(items / seconds);
+        result.items += items;
+    }
+
+    std::sort(rates.begin(), rates.end());
+    result.perSecond = rates[rates.size() / 2];
+    result.minPerSecond = rates.front();
+    result.maxPerSecond = rates.back();
+    return result;
+}
+
+Matrix randomMatrix(size_t rows, size_t cols, Xoshiro256& rng) {
+    Matrix m(rows, cols);
+    for (auto& row : m.data)
+        for (float& x : row)
+            x = (float)rng.uniform() * 2.f - 1.f;
+    return m;
+}
+
+// Unfinished positions reached by seeded random playouts, so every run and every machine sees
+// the same set
+std::vector<Position> benchmarkPositions(size_t count) {
+    std::vector<Position> positions;
+    Xoshiro256 rng(20240601);
+    MoveList moves;
+    while (positions.size() < count) {
+        Position position = Position::startPosition();
+        for (size_t ply = 0; ply < 120 && positions.size() < count; ++ply) {
+            position.generateLegal(moves);
+            if (moves.size == 0 || position.gameResult() != std::string("Game continues")) break;
+            if (ply % 8 == 0) positions.push_back(position);
+            position.makeMove(moves[rng.below(moves.size)]);
+        }
+    }
+    return positions;
+}
+
+std::vector<BenchResult> runBenchmarks(const BenchOptions& options) {
+    std::vector<BenchResult> results;
+    auto run = [&](const std::string& name, const std::string& unit, const std::function<uint64_t()>& body) {
+        if (!options.filter.empty() && name.find(options.filter) == std::string::npos) return;
+        results.push_back(measure(options, name, unit, body));
+        const BenchResult& r = results.back();
+        std::cout << "  " << r.name << ": " << r.perSecond << " " << r.unit << "/s" << std::endl;
+    };
+
+    Xoshiro256 rng(1);
+    NeuralNetwork network(772, 128, { 500, 500 }, 1);
+    const size_t batch = 32;
+
+    // The network's layer shapes: 500x772, 500x500 and 128x500, for one column and a batch
+    const size_t shapes[3][2] = { { 500, 772 }, { 500, 500 }, { 128, 500 } };
+    for (const auto& shape : shapes) {
+        Matrix w = randomMatrix(shape[0], shape[1], rng);
+        Matrix x = randomMatrix(shape[1], 1, rng);
+        Matrix xs = randomMatrix(shape[1], batch, rng);
+        std::string dims = std::to_string(shape[0]) + "x" + std::to_string(shape[1]);
+        run("matmul/" + dims + "*1", "matmul", [w, x] { benchSink = (w * x).data[0][0]; return 1; });
+        run("matmul/" + dims + "*" + std::to_string(batch), "matmul", [w, xs] { benchSink = (w * xs).data[0][0]; return 1; });
+    }
+
+    Matrix hidden = randomMatrix(500, 1, rng);
+    Matrix logits = randomMatrix(128, 1, rng);
+    Matrix logitsBatch = randomMatrix(128, batch, rng);
+    run("activation/sigmoid500", "call", [hidden] { benchSink = hidden.sigmoid().data[0][0]; return 1; });
+    run("activation/sigmoidDerivative500", "call", [hidden] { benchSink = hidden.sigmoidDerivative().data[0][0]; return 1; });
+    run("activation/softmax128", "call", [logits] { benchSink = logits.softmax().data[0][0]; return 1; });
+    run("activation/softmaxColumns128x" + std::to_string(batch), "call", [logitsBatch] {
+        benchSink = logitsBatch.softmaxColumns().data[0][0];
+        return 1;
+    });
+
+    std::vector<Position> positions = benchmarkPositions(256);
+    std::vector<ChessBoard> boards;
+    for (const Position& position : positions)
+        boards.push_back(position.toChessBoard());
+
+    run("encode/encodeBoard", "position", [&] {
+        for (size_t i = 0; i < boards.size(); ++i)
+            benchSink = ChessBot::encodeBoard(boards[i], positions[i].whiteToMove).data[768][0];
+        return boards.size();
+    });
+
+    Matrix input = ChessBot::encodeBoard(boards[0], true);
+    Matrix inputs(772, batch);
+    for (size_t j = 0; j < batch; ++j)
+        Search::encode(positions[j], inputs, j);
+    run("network/forward", "position", [&] { benchSink = network.forward(input).data[0][0]; return 1; });
+    run("network/forwardBatch" + std::to_string(batch), "position", [&] {
+        benchSink = network.forwardBatch(inputs).data[0][0];
+        return batch;
+    });
+
+    size_t decided = 0;
+    run("inference/decideFromOutput", "position", [&] {
+        size_t i = decided++ % boards.size();
+        Matrix output = network.forward(ChessBot::encodeBoard(boards[i], positions[i].whiteToMove));
+        benchSink = (float)ChessBot::decideFromOutput(boards[i], positions[i].whiteToMove, output).to.row;
+        return 1;
+    });
+    run("inference/decideFromHidden", "position", [&] {
+        size_t i = decided++ % boards.size();
+        Matrix hidden = network.forwardHidden(ChessBot::encodeBoard(boards[i], positions[i].whiteToMove));
+        benchSink = (float)ChessBot::decideFromHidden(network, boards[i], positions[i].whiteToMove, hidden, 0).to.row;
+        return 1;
+    });
+
+    // The same network magnitude-pruned to 90%, multiplied through its CSR weights. Random
+    // weights have no small ones to spare, so its move choices are compared but not checked.
+    NeuralNetwork pruned(network);
+    pruned.prune(0.9);
+    size_t beforePruned = results.size();
+    run("network/forward/pruned90", "position", [&] { benchSink = pruned.forward(input).data[0][0]; return 1; });
+    run("network/forwardBatch" + std::to_string(batch) + "/pruned90", "position", [&] {
+        benchSink = pruned.forwardBatch(inputs).data[0][0];
+        return batch;
+    });
+    run("inference/decideFromHidden/pruned90", "position", [&] {
+        size_t i = decided++ % boards.size();
+        Matrix hidden = pruned.forwardHidden(ChessBot::encodeBoard(boards[i], positions[i].whiteToMove));
+        benchSink = (float)ChessBot::decideFromHidden(pruned, boards[i], positions[i].whiteToMove, hidden, 0).to.row;
+        return 1;
+    });
+    if (results.size() > beforePruned) {
+        size_t agreed = 0;
+        for (size_t i = 0; i < boards.size(); ++i) {
+            Matrix input = ChessBot::encodeBoard(boards[i], positions[i].whiteToMove);
+            Move dense = ChessBot::decideFromHidden(network, boards[i], positions[i].whiteToMove, network.forwardHidden(input), 0);
+            Move sparse = ChessBot::decideFromHidden(pruned, boards[i], positions[i].whiteToMove, pruned.forwardHidden(input), 0);
+            agreed += packMove(dense) == packMove(sparse);
+        }
+        std::cout << "  pruned90: " << pruned.inferenceWeightBytes() << " weight bytes read per forward against "
+                  << network.inferenceWeightBytes() << ", same move as the dense network in " << agreed << "/"
+                  << boards.size() << " positions" << std::endl;
+    }
+
+    NeuralNetwork trained(network);
+    Matrix target(128, 1);
+    target.data[12][0] = 0.5f;
+    target.data[64 + 28][0] = 0.5f;
+    run("network/backprop", "sample", [&] { trained.backprop(input, target, 0.001); return 1; });
+
+    run("movegen/Position::generateLegal", "position", [&] {
+        MoveList moves;
+        uint64_t total = 0;
+        for (Position& position : positions) {
+            position.generateLegal(moves);
+            total += moves.size;
+        }
+        benchSink = (float)total;
+        return positions.size();
+    });
+    run("movegen/ChessBoard::getValidMoves", "position", [&] {
+        uint64_t total = 0;
+        for (size_t i = 0; i < boards.size(); ++i) {
+            for (int square = 0; square < 64; ++square) {
+                if (!Position::isColor(positions[i].squares[square], positions[i].whiteToMove)) continue;
+                auto moves = boards[i].getValidMoves({ square / 8, square % 8 });
+                total += moves[0][0];
+            }
+        }
+        benchSink = (float)total;
+        return boards.size();
+    });
+
+    uint64_t playoutSeed = 7;
+    run("selfplay/randomPlayout", "game", [&] {
+        Xoshiro256 playoutRng(playoutSeed++);
+        Position position = Position::startPosition();
+        benchSink = (float)randomPlayout(position, playoutRng).plies;
+        return 1;
+    });
+
+    uint64_t gameSeed = 1;
+    run("selfplay/botVsBot", "game", [&] {
+        SelfPlayConfig config;
+        config.threads = 1;
+        config.games = 1;
+        config.seed = gameSeed++;
+        SelfPlayRunner runner(config, network, network);
+        return runner.run().games;
+    });
+
+    return results;
+}
+
+std::string jsonEscape(const std::string& text) {
+    std::string out;
+    for (char c : text) {
+        if (c == '"' || c == '\\') out += '\\';
+        out += c;
+    }
+    return out;
+}
+
+bool writeResults(const std::vector<BenchResult>& results, const std::string& path) {
+    std::ofstream out(path);
+    if (!out.is_open()) {
+        std::cerr << "Error: Could not open the file '" << path << "'" << std::endl;
+        return false;
+    }
+    out.precision(6);
+    out << "{\n  \"format\": 1,\n  \"results\": [\n";
+    for (size_t i = 0; i < results.size(); ++i) {
+        const BenchResult& r = results[i];
+        out << "    { \"name\": \"" << jsonEscape(r.name) << "\", \"unit\": \"" << jsonEscape(r.unit)
+            << "\", \"perSecond\": " << r.perSecond << ", \"minPerSecond\": " << r.minPerSecond
+            << ", \"maxPerSecond\": " << r.maxPerSecond << ", \"items\": " << r.items << " }"
+            << (i + 1 < results.size() ? "," : "") << "\n";
+    }
+    out << "  ]\n}\n";
+    return true;
+}
+
+// Reads name -> perSecond back from a file written by writeResults
+std::map<std::string, double> readBaseline(const std::string& path) {
+    std::map<std::string, double> baseline;
+    std::ifstream in(path);
+    if (!in.is_open()) return baseline;
+    std::stringstream buffer;
+    buffer << in.rdbuf();
+    std::string text = buffer.str();
+
+    const std::string nameKey = "\"name\": \"", rateKey = "\"perSecond\": ";
+    for (size_t pos = text.find(nameKey); pos != std::string::npos; pos = text.find(nameKey, pos)) {
+        pos += nameKey.size();
+        std::string name;
+        while (pos < text.size() && text[pos] != '"') {
+            if (text[pos] == '\\') pos++;
+            name += text[pos++];
+        }
+        size_t rate = text.find(rateKey, pos);
+        if (rate == std::string::npos) break;
+        baseline[name] = std::stod(text.substr(rate + rateKey.size(), 32));
+    }
+    return baseline;
+}
+
+// Returns the number of regressions
+size_t compareWithBaseline(const std::vector<BenchResult>& results, const std::map<std::string, double>& baseline,
+                           double threshold) {
+    size_t regressions = 0;
+    std::cout << "\nAgainst baseline (fail below -" << threshold * 100.0 << "%):" << std::endl;
+    for (const BenchResult& r : results) {
+        auto found = baseline.find(r.name);
+        if (found == baseline.end() || found->second <= 0.0) {
+            std::cout << "  " << r.name << ": no baseline" << std::endl;
+            continue;
+        }
+        double change = r.perSecond / found->second - 1.0;
+        bool regressed = change < -threshold;
+        regressions += regressed;
+        char line[256];
+        std::snprintf(line, sizeof(line), "  %-40s %+7.1f%%%s", r.name.c_str(), change * 100.0, regressed ? "  REGRESSION" : "");
+        std::cout << line << std::endl;
+    }
+    return regressions;
+}
+
+int main(int argc, char** argv) {
+    BenchOptions options;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--quick") { options.samples = 3; options.minSeconds = 0.1; }
+        else if (arg == "--filter" && i + 1 < argc) options.filter = argv[++i];
+        else if (arg == "--samples" && i + 1 < argc) options.samples = std::max<size_t>(std::stoul(argv[++i]), 1);
+        else if (arg == "--min-seconds" && i + 1 < argc) options.minSeconds = std::stod(argv[++i]);
+        else if (arg == "--out" && i + 1 < argc) options.outPath = argv[++i];
+        else if (arg == "--baseline" && i + 1 < argc) options.baselinePath = argv[++i];
+        else if (arg == "--threshold" && i + 1 < argc) options.threshold = std::stod(argv[++i]);
+        else if (arg == "--save-baseline" && i + 1 < argc) options.saveBaselinePath = argv[++i];
+        else {
+            std::cerr << "Error: unknown argument '" << arg << "'" << std::endl;
+            return 2;
+        }
+    }
+
+    std::cout << "Running benchmarks (" << options.samples << " samples of >= " << options.minSeconds << "s)" << std::endl;
+    std::vector<BenchResult> results = runBenchmarks(options);
+
+    if (!writeResults(results, options.outPath)) return 2;
+    std::cout << "Successfully wrote " << results.size() << " results to " << options.outPath << std::endl;
+    if (!options.saveBaselinePath.empty()) {
+        if (!writeResults(results, options.saveBaselinePath)) return 2;
+        std::cout << "Saved baseline to " << options.saveBaselinePath << std::endl;
+        return 0;
+    }
+
+    if (!std::filesystem::exists(options.baselinePath)) {
+        std::cout << "No baseline at " << options.baselinePath << ", skipping the regression check" << std::endl;
+        return 0;
+    }
+    size_t regressions = compareWithBaseline(results, readBaseline(options.baselinePath), options.threshold);
+    if (regressions) {
+        std::cout << regressions << " benchmark(s) regressed" << std::endl;
+        return 1;
+    }
+    return 0;
+}
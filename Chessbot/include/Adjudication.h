@@ -0,0 +1,76 @@
+#pragma once
+#include <ChessBoard.h>
+#include <Random.h>
+#include <Search.h>
+#include <cstdint>
+#include <string>
+
+// Ends bot games whose outcome looks settled instead of playing on to the 50-move rule. The
+// networks only have a policy output, so the material balance stands in for a value estimate.
+struct AdjudicationConfig {
+    bool enabled = false;
+    int resignMaterial = 500;   // the trailing side resigns once behind by at least this
+    size_t resignPlies = 20;    // for this many plies in a row
+    int drawMaterial = 100;     // a draw is declared once the balance stays within this
+    size_t drawPlies = 40;      // for this many plies in a row
+    size_t drawMinPly = 60;     // but not before this ply
+    // Share of games played to the end anyway, recording the verdict adjudication would have
+    // given, so its false-adjudication rate can be measured
+    double noAdjudicationRate = 0.05;
+};
+
+// One game's adjudication state, reset at the start of every game
+struct Adjudication {
+    size_t ply = 0;
+    size_t resignRun = 0;
+    size_t drawRun = 0;
+    int leader = 0;       // 1 white, -1 black, 0 neither past resignMaterial
+    bool decided = false;
+    bool playOut = false; // sampled game: the verdict is recorded but the game continues
+
+    void reset(const AdjudicationConfig& config, uint64_t gameSeed) {
+        ply = resignRun = drawRun = 0;
+        leader = 0;
+        decided = false;
+        // Drawn from the game seed, so which games are sampled doesn't depend on scheduling
+        playOut = (splitMix64(gameSeed ^ 0xAD1D1CA7Eull) >> 11) * 0x1.0p-53 < config.noAdjudicationRate;
+    }
+
+    // Call once per position before its move; returns the verdict the first time one is reached
+    const char* update(const AdjudicationConfig& config, const ChessBoard& board) {
+        if (decided) return nullptr;
+        int balance = materialBalance(board);
+        ply++;
+
+        int side = balance >= config.resignMaterial ? 1 : balance <= -config.resignMaterial ? -1 : 0;
+        resignRun = side != 0 && side == leader ? resignRun + 1 : side != 0;
+        leader = side;
+        drawRun = balance >= -config.drawMaterial && balance <= config.drawMaterial ? drawRun + 1 : 0;
+
+        const char* verdict = nullptr;
+        if (resignRun >= config.resignPlies)
+            verdict = leader > 0 ? "White wins (Resignation)" : "Black wins (Resignation)";
+        else if (drawRun >= config.drawPlies && ply >= config.drawMinPly)
+            verdict = "Draw (Adjudication)";
+        decided = verdict != nullptr;
+        return verdict;
+    }
+
+    // White's material minus black's, in Search::pieceValue units
+    static int materialBalance(const ChessBoard& board) {
+        int balance = 0;
+        for (const auto& row : board.board) {
+            for (Piece piece : row) {
+                if (piece >= Piece::WhitePawn && piece <= Piece::WhiteKing) balance += Search::pieceValue(piece);
+                else if (piece != Piece::Empty) balance -= Search::pieceValue(piece);
+            }
+        }
+        return balance;
+    }
+
+    // Results only adjudication produces; the rules alone would say the game continues
+    static bool isVerdict(const std::string& result) {
+        return result == "White wins (Resignation)" || result == "Black wins (Resignation)" ||
+               result == "Draw (Adjudication)";
+    }
+};
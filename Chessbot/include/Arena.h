@@ -0,0 +1,193 @@
+#pragma once
+#include <ChessBot.h>
+#include <RandomPlayout.h>
+#include <ThreadPool.h>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <mutex>
+#include <unordered_set>
+
+struct ArenaConfig {
+    size_t threads = std::thread::hardware_concurrency();
+    size_t maxPairs = 1000;      // a pair is one game with each color from the same opening
+    uint64_t seed = 0;
+    size_t openingCount = 0;     // generated when no openings are given; 0 generates maxPairs
+    size_t openingPlies = 8;     // random plies from the start position per generated opening
+    // SPRT of H0: elo = elo0 against H1: elo = elo1, candidate relative to baseline
+    double elo0 = 0.0;
+    double elo1 = 10.0;
+    double alpha = 0.05;
+    double beta = 0.05;
+    size_t minPairs = 8;         // don't stop before this many pairs
+};
+
+enum class SprtDecision { Continue, AcceptH0, AcceptH1 };
+
+// Results from the candidate's point of view. Pairs are counted in pentanomial form, by how
+// many of the pair's 2 points the candidate scored (0, 0.5, ..., 2), since both games share an
+// opening and are correlated.
+struct ArenaResult {
+    size_t wins = 0;
+    size_t draws = 0;
+    size_t losses = 0;
+    size_t pairs[5] = {};
+    double elo = 0.0;
+    double eloLow = 0.0;  // 95% confidence interval
+    double eloHigh = 0.0;
+    double llr = 0.0;
+    double lowerBound = 0.0;
+    double upperBound = 0.0;
+    SprtDecision decision = SprtDecision::Continue;
+    double seconds = 0.0;
+
+    size_t games() const { return wins + draws + losses; }
+    size_t pairCount() const { return pairs[0] + pairs[1] + pairs[2] + pairs[3] + pairs[4]; }
+
+    void print() const {
+        const char* verdict = decision == SprtDecision::AcceptH1 ? "H1 accepted (candidate is stronger)"
+                            : decision == SprtDecision::AcceptH0 ? "H0 accepted (candidate is not stronger)"
+                            : "inconclusive";
+        std::cout << games() << " games: +" << wins << " =" << draws << " -" << losses
+                  << ", pentanomial [" << pairs[0] << " " << pairs[1] << " " << pairs[2] << " " << pairs[3] << " " << pairs[4] << "]\n"
+                  << "Elo " << elo << " [" << eloLow << ", " << eloHigh << "], LLR " << llr
+                  << " (" << lowerBound << ", " << upperBound << "), " << verdict << ", " << seconds << "s" << std::endl;
+    }
+};
+
+// Plays color-swapped game pairs between a candidate and a baseline network from a set of
+// opening positions, and stops as soon as the SPRT decides, maxPairs have been played or the
+// openings run out. Each opening is played once: the bots are deterministic, so a repeated
+// opening replays the same pair and would count its result twice in the SPRT.
+class Arena {
+public:
+    Arena(const ArenaConfig& config, const NeuralNetwork& candidate, const NeuralNetwork& baseline)
+        : config(config), candidate(candidate), baseline(baseline) {}
+
+    void setOpenings(const std::vector<Position>& positions) {
+        openings = positions;
+    }
+
+    // Distinct random playouts of openingPlies from the start, skipping any that already ended.
+    // Returns fewer than count when that many distinct openings don't turn up, as with few plies.
+    static std::vector<Position> randomOpenings(size_t count, size_t plies, uint64_t seed) {
+        std::vector<Position> positions;
+        std::unordered_set<uint64_t> seen;
+        Xoshiro256 rng(seed);
+        for (size_t attempt = 0; positions.size() < count && attempt < count * 16; ++attempt) {
+            Position position = Position::startPosition();
+            randomPlayout(position, rng, nullptr, plies);
+            if (position.gameResult() == "Game continues" && seen.insert(position.hash).second)
+                positions.push_back(position);
+        }
+        return positions;
+    }
+
+    static double eloToScore(double elo) {
+        return 1.0 / (1.0 + std::pow(10.0, -elo / 400.0));
+    }
+
+    static double scoreToElo(double score) {
+        score = std::min(std::max(score, 1e-6), 1.0 - 1e-6);
+        return -400.0 * std::log10(1.0 / score - 1.0);
+    }
+
+    // Elo, confidence interval and the normal-approximation log-likelihood ratio from the
+    // pentanomial counts. A weak prior of a quarter pair per outcome keeps the variance away
+    // from zero while every pair so far has scored the same, which is common between
+    // deterministic bots.
+    static void updateStatistics(ArenaResult& result, const ArenaConfig& config) {
+        result.lowerBound = std::log(config.beta / (1.0 - config.alpha));
+        result.upperBound = std::log((1.0 - config.beta) / config.alpha);
+        if (result.pairCount() == 0) return;
+
+        const double prior = 0.25;
+        double n = 0.0, mean = 0.0, squares = 0.0;
+        for (int k = 0; k < 5; ++k) {
+            double count = result.pairs[k] + prior;
+            double score = k / 4.0;
+            n += count;
+            mean += count * score;
+            squares += count * score * score;
+        }
+        mean /= n;
+        double variance = squares / n - mean * mean;
+        double error = std::sqrt(variance / n);
+
+        result.elo = scoreToElo(mean);
+        result.eloLow = scoreToElo(mean - 1.96 * error);
+        result.eloHigh = scoreToElo(mean + 1.96 * error);
+
+        double s0 = eloToScore(config.elo0), s1 = eloToScore(config.elo1);
+        result.llr = n * (s1 - s0) * (2.0 * mean - s0 - s1) / (2.0 * variance);
+
+        if (result.pairCount() < config.minPairs) result.decision = SprtDecision::Continue;
+        else if (result.llr >= result.upperBound) result.decision = SprtDecision::AcceptH1;
+        else if (result.llr <= result.lowerBound) result.decision = SprtDecision::AcceptH0;
+        else result.decision = SprtDecision::Continue;
+    }
+
+    ArenaResult run() {
+        if (openings.empty()) {
+            size_t count = config.openingCount ? config.openingCount : config.maxPairs;
+            openings = randomOpenings(std::max<size_t>(count, 1), config.openingPlies, config.seed);
+        }
+        size_t pairs = std::min(config.maxPairs, openings.size());
+
+        ArenaResult result;
+        updateStatistics(result, config);
+        std::mutex resultMutex;
+        std::atomic<bool> stop{ false };
+
+        ThreadPool pool(config.threads);
+        auto start = std::chrono::steady_clock::now();
+        for (size_t pair = 0; pair < pairs; ++pair) {
+            pool.submit([&, pair](size_t) {
+                if (stop) return;
+                const Position& opening = openings[pair];
+                double first = playGame(opening, true);
+                double second = playGame(opening, false);
+
+                std::lock_guard<std::mutex> lock(resultMutex);
+                if (stop) return;
+                for (double score : { first, second }) {
+                    if (score == 1.0) result.wins++;
+                    else if (score == 0.0) result.losses++;
+                    else result.draws++;
+                }
+                result.pairs[(int)((first + second) * 2)]++;
+                updateStatistics(result, config);
+                if (result.decision != SprtDecision::Continue) stop = true;
+            });
+        }
+        pool.waitIdle();
+        result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        return result;
+    }
+
+private:
+    ArenaConfig config;
+    const NeuralNetwork& candidate;
+    const NeuralNetwork& baseline;
+    std::vector<Position> openings;
+
+    // Candidate's score (1, 0.5 or 0) for one game from opening
+    double playGame(const Position& opening, bool candidateIsWhite) const {
+        ChessBoard board = opening.toChessBoard();
+        bool whiteTurn = opening.whiteToMove;
+
+        while (true) {
+            std::string result = board.getGameResult(whiteTurn);
+            if (result != "Game continues") {
+                GameOutcome outcome = outcomeFromResult(result);
+                if (outcome == GameOutcome::Draw) return 0.5;
+                return (outcome == GameOutcome::WhiteWins) == candidateIsWhite ? 1.0 : 0.0;
+            }
+
+            const NeuralNetwork& network = (whiteTurn == candidateIsWhite) ? candidate : baseline;
+            Matrix output = network.forward(ChessBot::encodeBoard(board, whiteTurn));
+            board.makeMove(ChessBot::decideFromOutput(board, whiteTurn, output));
+            whiteTurn = !whiteTurn;
+        }
+    }
+};
@@ -0,0 +1,200 @@
+#pragma once
+#include <NeuralNetwork.h>
+#include <Position.h>
+#include <Search.h>
+#include <TranspositionTable.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+
+// Flags shared by a running decision and whoever controls it. Search polls the atomics; the
+// condition variable wakes a finished decision whose result is being held back.
+struct DecisionControl {
+    std::atomic<bool> cancelled{ false };
+    std::atomic<bool> pondering{ false }; // budgets suspended until ponderHit
+    std::mutex mutex;
+    std::condition_variable changed;
+
+    void cancel() { set(cancelled, true); }
+    void ponderHit() { set(pondering, false); }
+
+    // Returns once cancelled, or once not pondering unless holdUntilCancelled
+    void waitForRelease(bool holdUntilCancelled) {
+        std::unique_lock<std::mutex> lock(mutex);
+        changed.wait(lock, [&] { return cancelled.load() || (!holdUntilCancelled && !pondering.load()); });
+    }
+
+private:
+    void set(std::atomic<bool>& flag, bool value) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            flag = value;
+        }
+        changed.notify_all();
+    }
+};
+
+// A decision running on a background thread. cancel() asks it to stop and return the best move
+// found so far; the search checks the flag every node, so the future is ready shortly after.
+struct PendingMove {
+    std::shared_future<SearchResult> result;
+    std::shared_ptr<DecisionControl> control;
+
+    void cancel() {
+        if (control) control->cancel();
+    }
+
+    bool valid() const { return result.valid(); }
+    bool ready() const { return result.wait_for(std::chrono::seconds(0)) == std::future_status::ready; }
+    SearchResult get() const { return result.get(); }
+};
+
+// How one decision runs. The callbacks are called on the decision's thread.
+struct DecisionOptions {
+    // Keeps the result back until cancelled even after the search ends, as UCI's go infinite wants
+    bool holdUntilCancelled = false;
+    std::function<void(const SearchResult&)> onIteration; // after every completed Search iteration
+    std::function<void(const SearchResult&)> onDecided;   // with the result, once it is released
+    std::function<SearchResult(const Position&)> decide;  // replaces Search, e.g. a single forward pass
+};
+
+struct PonderStats {
+    size_t ponders = 0;
+    size_t hits = 0;
+    size_t misses = 0;
+};
+
+// Asynchronous, cancellable move decisions with pondering. A ponder searches a position during
+// the opponent's time with its budgets suspended: either the position after the reply our own
+// PV expects (startPondering), or one the caller picks (ponderAsync, as for UCI's go ponder). On
+// a ponder hit that search simply continues, under the limits it was started with, its budgets
+// counting from the hit; a ponder that ends early holds its result until then. On a miss it is
+// cancelled and a fresh search started. All searches share one transposition table, so even a
+// miss starts with the entries pondering left behind.
+//
+// One decision runs at a time, controlled from one thread. The player must outlive the
+// decisions it hands out.
+class AsyncPlayer {
+public:
+    explicit AsyncPlayer(std::shared_ptr<NeuralNetwork> network, size_t tableMegabytes = 64)
+        : network(std::move(network)), table(tableMegabytes) {}
+
+    ~AsyncPlayer() {
+        stop();
+    }
+
+    AsyncPlayer(const AsyncPlayer&) = delete;
+    AsyncPlayer& operator=(const AsyncPlayer&) = delete;
+
+    // Starts searching position; any decision or ponder still running is stopped first
+    PendingMove decideAsync(const Position& position, const SearchLimits& limits,
+                            const DecisionOptions& options = DecisionOptions()) {
+        stop();
+        return start(position, limits, options, false);
+    }
+
+    // Ponders on position until ponderHit() or stop()
+    PendingMove ponderAsync(const Position& position, const SearchLimits& limits,
+                            const DecisionOptions& options = DecisionOptions()) {
+        stop();
+        stats.ponders++;
+        return start(position, limits, options, true);
+    }
+
+    // Call after playing our move from result's search. Returns false when the PV doesn't say
+    // what reply to expect or the game is over.
+    bool startPondering(const Position& afterOurMove, const SearchResult& result, const SearchLimits& limits,
+                        const DecisionOptions& options = DecisionOptions()) {
+        stop();
+        if (result.pv.size() < 2) return false;
+        Position expected = afterOurMove;
+        MoveList legal;
+        expected.generateLegal(legal);
+        if (!legal.contains(result.pv[1])) return false;
+        expected.makeMove(result.pv[1]);
+
+        ponderAsync(expected, limits, options);
+        expectedReply = result.pv[1];
+        expectedHash = expected.hash;
+        hasExpectedReply = true;
+        return true;
+    }
+
+    bool isPondering() const { return current.control && current.control->pondering; }
+
+    // The ponder becomes the decision, its budgets starting now. Returns it, or an invalid
+    // PendingMove when not pondering.
+    PendingMove ponderHit() {
+        if (!isPondering()) return PendingMove();
+        current.control->ponderHit();
+        stats.hits++;
+        return current;
+    }
+
+    // The opponent replied with reply, leaving afterReply. Keeps the ponder search on a hit,
+    // with the limits it was started with; otherwise starts a new one with limits.
+    PendingMove opponentMoved(const Position& afterReply, SquareMove reply, const SearchLimits& limits,
+                              const DecisionOptions& options = DecisionOptions()) {
+        if (isPondering() && hasExpectedReply && reply == expectedReply && afterReply.hash == expectedHash)
+            return ponderHit();
+        return decideAsync(afterReply, limits, options);
+    }
+
+    // Cancels the running decision, if any, and waits for it; a ponder stopped this way is a miss
+    void stop() {
+        if (!current.valid()) return;
+        if (isPondering()) stats.misses++;
+        current.cancel();
+        current.result.wait();
+        current = PendingMove();
+    }
+
+    void clear() {
+        stop();
+        table.clear();
+    }
+
+    // Only to be resized or cleared while no decision runs
+    TranspositionTable& transpositionTable() { return table; }
+
+    const PonderStats& ponderStats() const { return stats; }
+
+private:
+    std::shared_ptr<NeuralNetwork> network;
+    TranspositionTable table;
+    PendingMove current;
+    bool hasExpectedReply = false; // whether the current ponder came from startPondering
+    SquareMove expectedReply;
+    uint64_t expectedHash = 0;
+    PonderStats stats;
+
+    PendingMove start(const Position& position, SearchLimits limits, const DecisionOptions& options, bool ponder) {
+        PendingMove pending;
+        pending.control = std::make_shared<DecisionControl>();
+        pending.control->pondering = ponder;
+        limits.stop = &pending.control->cancelled;
+        limits.pondering = &pending.control->pondering;
+        // The control is captured by value so it outlives a caller dropping its PendingMove
+        pending.result = std::async(std::launch::async, [this, position, limits, options, control = pending.control] {
+            SearchResult result;
+            if (options.decide) {
+                result = options.decide(position);
+            }
+            else {
+                Search search(*network, &table);
+                search.onIteration = options.onIteration;
+                result = search.search(position, limits);
+            }
+            control->waitForRelease(options.holdUntilCancelled);
+            if (options.onDecided) options.onDecided(result);
+            return result;
+        }).share();
+        current = pending;
+        hasExpectedReply = false;
+        return pending;
+    }
+};
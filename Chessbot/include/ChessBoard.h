@@ -1,6 +1,11 @@
 #pragma once
+#include <Profiler.h>
+#include <algorithm>
 #include <array>
+#include <cstdint>
 #include <iostream>
+#include <string>
+#include <vector>
 
 enum class Piece {
     Empty,
@@ -18,6 +23,45 @@ struct Move {
     Coord to;
 };
 
+// 6 bits per square index (row * 8 + col): from in the low bits, to above it
+inline uint16_t packMove(const Move& move) {
+    return (uint16_t)((move.from.row * 8 + move.from.col) | ((move.to.row * 8 + move.to.col) << 6));
+}
+
+inline Move unpackMove(uint16_t packed) {
+    int from = packed & 63;
+    int to = (packed >> 6) & 63;
+    return { { from / 8, from % 8 }, { to / 8, to % 8 } };
+}
+
+enum class GameOutcome {
+    Ongoing,
+    WhiteWins,
+    BlackWins,
+    Draw
+};
+
+// Maps the strings returned by ChessBoard::getGameResult onto an outcome
+inline GameOutcome outcomeFromResult(const std::string& result) {
+    if (result.rfind("White wins", 0) == 0) return GameOutcome::WhiteWins;
+    if (result.rfind("Black wins", 0) == 0) return GameOutcome::BlackWins;
+    if (result.rfind("Draw", 0) == 0) return GameOutcome::Draw;
+    return GameOutcome::Ongoing;
+}
+
+// Optional adjudication of positions with few pieces, set by Tablebase::install. squares is 64
+// pieces indexed row * 8 + col and pliesSinceZeroing the smaller of the two 50-move counters;
+// the result is a getGameResult string, or nullptr to play on.
+struct Adjudicator {
+    const char* (*adjudicate)(const Piece* squares, bool whiteToMove, int pliesSinceZeroing) = nullptr;
+    int maxPieces = 0; // positions with more pieces are never adjudicated
+};
+
+inline Adjudicator& adjudicator() {
+    static Adjudicator instance;
+    return instance;
+}
+
 class ChessBoard {
 public: 
     std::array<std::array<Piece, 8>, 8> board;
@@ -201,6 +245,7 @@ public:
     //}
 
     std::array<std::array<bool, 8>, 8> getValidMoves(Coord from) const {
+        PROFILE_SCOPE(ProfileZone::MoveGen);
         std::array<std::array<bool, 8>, 8> legalMoves = {};
         if (!isInside(from.row, from.col)) return legalMoves;
 
@@ -394,6 +439,7 @@ public:
 
 
     bool isInCheck(bool whiteTurn) const {
+        PROFILE_SCOPE(ProfileZone::IsInCheck);
         int kingRow = -1, kingCol = -1;
         for (int r = 0; r < 8; ++r) {
             for (int c = 0; c < 8; ++c) {
@@ -472,6 +518,12 @@ public:
             return "Draw (50-move rule)";
         }
 
+        if (adjudicator().adjudicate) {
+            const char* adjudicated = adjudicator().adjudicate(&board[0][0], whiteTurn,
+                std::min(movesSinceCapture, movesSincePawnMovement));
+            if (adjudicated) return adjudicated;
+        }
+
         return "Game continues";
     }
 
@@ -540,6 +592,20 @@ public:
         return moves;
     }
 
+    int getMovesSincePawnMovement() const {
+        return movesSincePawnMovement;
+    }
+
+    int getMovesSinceCapture() const {
+        return movesSinceCapture;
+    }
+
+    // For restoring a position saved elsewhere
+    void setMoveCounters(int sincePawnMovement, int sinceCapture) {
+        movesSincePawnMovement = sincePawnMovement;
+        movesSinceCapture = sinceCapture;
+    }
+
     float getPercentageToward50MoveRulePawns() const {
         return movesSincePawnMovement / 50.f;
     }
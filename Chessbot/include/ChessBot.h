@@ -1,20 +1,37 @@
 #pragma once
 #include "NeuralNetwork.h"
 #include "ChessBoard.h"
+#include "Search.h"
+#include "EvalCache.h"
 #include <random>
 #include <limits>
+#include <memory>
 #include <cassert>
 
 struct ChessBot {
-	NeuralNetwork chessnet;
+	// Inputs and outputs are from the side to move's perspective, so both sides can share one network
+	std::shared_ptr<NeuralNetwork> chessnet;
 	bool isWhite = false;
+	EvalCache* evalCache = nullptr; // optional, may be shared between bots and threads
+	// Without a cache, decide from the output logits of legal squares only (see decideFromHidden)
+	bool legalLogitsOnly = true;
 
-	// 770 = 768 (board state: 64 * 6 * 2) + 2 (whos turn) + 2 (%s toward 50-move rule)
-	ChessBot(bool isWhite) : chessnet(772, 128, { 500, 500 }) {
+	// 772 = 768 (board state: 64 * 6 * 2) + 2 (whos turn) + 2 (%s toward 50-move rule)
+	ChessBot(bool isWhite) : chessnet(std::make_shared<NeuralNetwork>(772, 128, std::vector<size_t>{ 500, 500 })) {
 		this->isWhite = isWhite;
 	}
 
-	void insertAsOneHot(bool isWhite, int index, std::vector<float>& vector) {
+	// Plays with its own copy of network
+	ChessBot(bool isWhite, const NeuralNetwork& network) : chessnet(std::make_shared<NeuralNetwork>(network)) {
+		this->isWhite = isWhite;
+	}
+
+	// Plays with network itself, e.g. the same instance as the opposing bot
+	ChessBot(bool isWhite, std::shared_ptr<NeuralNetwork> network) : chessnet(std::move(network)) {
+		this->isWhite = isWhite;
+	}
+
+	static void insertAsOneHot(bool isWhite, int index, std::vector<float>& vector) {
 		if (index < 0) {
 			vector.insert(vector.end(), 12, 0.f);
 		}
@@ -31,18 +48,26 @@ struct ChessBot {
 		}
 	}
 
-	Matrix encodeBoard(const ChessBoard& board) {
+	Matrix encodeBoard(const ChessBoard& board) const {
+		return encodeBoard(board, isWhite);
+	}
+
+	// Encoding for an arbitrary side to move, for callers that don't own a bot per side. The board
+	// is seen from the side to move (see perspectiveSquare), so the first six planes are always
+	// the mover's pieces and the turn inputs are constant; they're kept so the layout stays 772 wide.
+	static Matrix encodeBoard(const ChessBoard& board, bool isWhite) {
+		PROFILE_SCOPE(ProfileZone::EncodeBoard);
 		std::vector<float> encodingVector;
 		encodingVector.reserve(772);
 
-		for (auto& row : board.board) {
-			for(Piece piece : row) {
-				insertAsOneHot(board.isWhitePiece(piece), (int)piece - 1, encodingVector);
-			}
+		for (int square = 0; square < 64; ++square) {
+			int actual = perspectiveSquare(square, isWhite);
+			int index = perspectivePiece((int)board.board[actual / 8][actual % 8], isWhite) - 1;
+			insertAsOneHot(index < 6, index, encodingVector);
 		}
 
-		encodingVector.push_back(isWhite ? 1.f : 0.f);
-		encodingVector.push_back(!isWhite ? 1.f : 0.f);
+		encodingVector.push_back(1.f);
+		encodingVector.push_back(0.f);
 
 		encodingVector.push_back(board.getPercentageToward50MoveRuleCaptures());
 		encodingVector.push_back(board.getPercentageToward50MoveRulePawns());
@@ -50,14 +75,14 @@ struct ChessBot {
 		return Matrix::fromVector(encodingVector);
 	}
 
-	Coord getMostConfidentPosition(const Matrix& modelOutput, const std::vector<Coord>& possibleChoices, bool isDestination) {
+	static Coord getMostConfidentPosition(const Matrix& modelOutput, const std::vector<Coord>& possibleChoices, bool isDestination, bool isWhite) {
 		assert(possibleChoices.size() > 0 && "Bot has no possible choices.");
 		int offset = isDestination ? 64 : 0;
 		float max = std::numeric_limits<float>::lowest();
 		Coord mostConfidentMove;
 
 		for (const Coord& coord : possibleChoices) {
-			float confidence = modelOutput.data[coord.row * 8 + coord.col + offset][0];
+			float confidence = modelOutput.data[perspectiveSquare(coord.row * 8 + coord.col, isWhite) + offset][0];
 			if (confidence > max) {
 				max = confidence;
 				mostConfidentMove = coord;
@@ -68,7 +93,7 @@ struct ChessBot {
 	}
 
 	Coord getMovablePieceDecision(const Matrix& modelOutput, const std::vector<Coord>& movablePieces) {
-		return getMostConfidentPosition(modelOutput, movablePieces, false);
+		return getMostConfidentPosition(modelOutput, movablePieces, false, isWhite);
 	}
 
 	Coord getDestinationDecision(const Matrix& modelOutput, const std::vector<Coord>& movablePieces) {
@@ -76,7 +101,7 @@ struct ChessBot {
 		Coord mostConfidentMove = movablePieces[0];
 
 		for (const Coord& coord : movablePieces) {
-			float confidence = modelOutput.data[coord.row * 8 + coord.col][0];
+			float confidence = modelOutput.data[perspectiveSquare(coord.row * 8 + coord.col, isWhite)][0];
 			if (confidence > max) {
 				max = confidence;
 				mostConfidentMove = coord;
@@ -86,18 +111,121 @@ struct ChessBot {
 		return mostConfidentMove;
 	}
 
+	// Network output with this bot to move, skipping inference on a cache hit
+	Matrix evaluate(const ChessBoard& board) const {
+		if (!evalCache) return chessnet->forward(encodeBoard(board));
+
+		uint64_t key = EvalCache::key(board, isWhite);
+		Matrix output(chessnet->outputSize, 1);
+		if (evalCache->lookup(key, chessnet->version, output)) return output;
+		output = chessnet->forward(encodeBoard(board));
+		evalCache->insert(key, chessnet->version, output);
+		return output;
+	}
+
 	Move decideMove(const ChessBoard& board) {
-		Move move;
+		if (legalLogitsOnly && !evalCache)
+			return decideFromHidden(*chessnet, board, isWhite, chessnet->forwardHidden(encodeBoard(board)), 0);
+		Matrix rawOutput = evaluate(board);
+		return decideFromOutput(board, isWhite, rawOutput);
+	}
 
-		Matrix input = encodeBoard(board);
+	// Alpha-beta search within the budget instead of the single greedy forward pass
+	Move searchMove(const ChessBoard& board, const SearchLimits& limits) const {
+		Search search(*chessnet);
+		SearchResult result = search.search(Position::fromChessBoard(board, isWhite), limits);
+		assert(result.hasMove && "Bot has ran out of possible moves. Game should have ended already.");
+		return result.bestMove.toMove();
+	}
+
+	// One batched forward pass for several positions where this bot is to move. With a cache
+	// only the misses go through the network.
+	std::vector<Move> decideMoves(const std::vector<const ChessBoard*>& boards) {
+		return decideMoves(boards, std::vector<bool>(boards.size(), isWhite));
+	}
+
+	// Same, with each board's own side to move, so both colors of a shared network's games can
+	// go into one batch
+	std::vector<Move> decideMoves(const std::vector<const ChessBoard*>& boards, const std::vector<bool>& whiteToMove) {
+		if (legalLogitsOnly && !evalCache) {
+			Matrix inputs(chessnet->inputSize, boards.size());
+			for (size_t i = 0; i < boards.size(); ++i)
+				inputs.setColumn(i, encodeBoard(*boards[i], whiteToMove[i]));
+			Matrix hidden = chessnet->forwardHidden(inputs);
+			std::vector<Move> moves(boards.size());
+			for (size_t i = 0; i < boards.size(); ++i)
+				moves[i] = decideFromHidden(*chessnet, *boards[i], whiteToMove[i], hidden, i);
+			return moves;
+		}
+
+		Matrix rawOutputs(chessnet->outputSize, boards.size());
+		std::vector<size_t> misses;
+		std::vector<uint64_t> keys(boards.size());
+		for (size_t i = 0; i < boards.size(); ++i) {
+			if (evalCache) {
+				keys[i] = EvalCache::key(*boards[i], whiteToMove[i]);
+				if (evalCache->lookup(keys[i], chessnet->version, rawOutputs, i)) continue;
+			}
+			misses.push_back(i);
+		}
+
+		if (!misses.empty()) {
+			Matrix inputs(chessnet->inputSize, misses.size());
+			for (size_t j = 0; j < misses.size(); ++j)
+				inputs.setColumn(j, encodeBoard(*boards[misses[j]], whiteToMove[misses[j]]));
+			Matrix outputs = chessnet->forwardBatch(inputs);
+			for (size_t j = 0; j < misses.size(); ++j) {
+				rawOutputs.setColumn(misses[j], outputs.column(j));
+				if (evalCache) evalCache->insert(keys[misses[j]], chessnet->version, outputs, j);
+			}
+		}
+
+		std::vector<Move> moves(boards.size());
+		for (size_t i = 0; i < boards.size(); ++i)
+			moves[i] = decideFromOutput(*boards[i], whiteToMove[i], rawOutputs.column(i));
+		return moves;
+	}
+
+	static Move decideFromOutput(const ChessBoard& board, bool isWhite, const Matrix& rawOutput) {
+		Move move;
 
 		std::vector<Coord> movablePieces = board.getMovablePieces(isWhite);
 		assert(movablePieces.size() > 0 && "Bot has ran out of possible moves. Game should have ended already.");
-		Matrix rawOutput = chessnet.forward(input);
-		move.from = getMostConfidentPosition(rawOutput, movablePieces, false);
+		move.from = getMostConfidentPosition(rawOutput, movablePieces, false, isWhite);
 		std::vector<Coord> validDestinations = board.getValidDestinations(move.from);
-		move.to = getMostConfidentPosition(rawOutput, validDestinations, true);
+		move.to = getMostConfidentPosition(rawOutput, validDestinations, true, isWhite);
 
 		return move;
 	}
+
+	// decideFromOutput without the full output layer: only the rows of movable pieces' squares and
+	// then of the chosen piece's destinations are computed, and the softmax is skipped since it
+	// doesn't change which logit is largest. hidden is forwardHidden's output.
+	static Move decideFromHidden(const NeuralNetwork& network, const ChessBoard& board, bool isWhite,
+		const Matrix& hidden, size_t column) {
+		PROFILE_SCOPE(ProfileZone::LegalLogits);
+		std::vector<float> activations(hidden.rows);
+		for (size_t k = 0; k < hidden.rows; ++k)
+			activations[k] = hidden.data[k][column];
+
+		auto mostConfident = [&](const std::vector<Coord>& choices, size_t offset) {
+			float max = std::numeric_limits<float>::lowest();
+			Coord best;
+			for (const Coord& coord : choices) {
+				float logit = network.outputLogit(activations, perspectiveSquare(coord.row * 8 + coord.col, isWhite) + offset);
+				if (logit > max) {
+					max = logit;
+					best = coord;
+				}
+			}
+			return best;
+		};
+
+		Move move;
+		std::vector<Coord> movablePieces = board.getMovablePieces(isWhite);
+		assert(movablePieces.size() > 0 && "Bot has ran out of possible moves. Game should have ended already.");
+		move.from = mostConfident(movablePieces, 0);
+		move.to = mostConfident(board.getValidDestinations(move.from), 64);
+		return move;
+	}
 };
@@ -0,0 +1,156 @@
+#pragma once
+#include <Matrix.h>
+#include <Position.h>
+#include <array>
+#include <atomic>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+struct EvalCacheStats {
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    uint64_t inserts = 0;
+    uint64_t evictions = 0;
+
+    double hitRate() const { return hits + misses ? (double)hits / (hits + misses) : 0.0; }
+
+    void print() const {
+        std::cout << "eval cache: " << hits << " hits, " << misses << " misses (" << hitRate() * 100.0
+                  << "% hit rate), " << inserts << " inserts, " << evictions << " evictions" << std::endl;
+    }
+};
+
+// Bounded, thread-safe cache of network outputs keyed by position and NeuralNetwork::version.
+// Entries for older versions never match again and are recycled by the clock: each shard sweeps
+// a hand over its slots, clearing reference bits set by hits, and evicts the first slot that
+// wasn't used since the last pass. Shards have their own mutex so threads rarely contend.
+class EvalCache {
+public:
+    static constexpr size_t OutputSize = 128;
+
+    explicit EvalCache(size_t capacity = 1 << 16) {
+        size_t perShard = std::max<size_t>(capacity / ShardCount, 1);
+        for (Shard& shard : shards) {
+            shard.slots.resize(perShard);
+            shard.index.reserve(perShard);
+        }
+    }
+
+    // The encoding includes the move counters, so unlike the Zobrist hash the key covers them
+    static uint64_t key(const Position& position) {
+        return position.hash ^ splitMix64(((uint64_t)position.movesSincePawnMovement << 32) | (uint32_t)position.movesSinceCapture);
+    }
+
+    static uint64_t key(const ChessBoard& board, bool whiteToMove) {
+        return key(Position::fromChessBoard(board, whiteToMove));
+    }
+
+    // Copies the cached output into column of output on a hit
+    bool lookup(uint64_t key, uint64_t version, Matrix& output, size_t column = 0) {
+        Shard& shard = shardFor(key, version);
+        {
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            auto found = shard.index.find(combine(key, version));
+            if (found != shard.index.end()) {
+                Slot& slot = shard.slots[found->second];
+                if (slot.key == key && slot.version == version) {
+                    slot.referenced = true;
+                    for (size_t i = 0; i < OutputSize; ++i)
+                        output.data[i][column] = slot.output[i];
+                    hits.fetch_add(1, std::memory_order_relaxed);
+                    return true;
+                }
+            }
+        }
+        misses.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    void insert(uint64_t key, uint64_t version, const Matrix& output, size_t column = 0) {
+        Shard& shard = shardFor(key, version);
+        uint64_t combined = combine(key, version);
+        std::lock_guard<std::mutex> lock(shard.mutex);
+
+        size_t target;
+        auto found = shard.index.find(combined);
+        if (found != shard.index.end()) {
+            target = found->second;
+        }
+        else {
+            while (shard.slots[shard.hand].used && shard.slots[shard.hand].referenced) {
+                shard.slots[shard.hand].referenced = false;
+                shard.hand = (shard.hand + 1) % shard.slots.size();
+            }
+            target = shard.hand;
+            shard.hand = (shard.hand + 1) % shard.slots.size();
+
+            Slot& victim = shard.slots[target];
+            if (victim.used) {
+                shard.index.erase(combine(victim.key, victim.version));
+                evictions.fetch_add(1, std::memory_order_relaxed);
+            }
+            shard.index[combined] = target;
+        }
+
+        Slot& slot = shard.slots[target];
+        slot.key = key;
+        slot.version = version;
+        slot.used = true;
+        slot.referenced = false;
+        for (size_t i = 0; i < OutputSize; ++i)
+            slot.output[i] = output.data[i][column];
+        inserts.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void clear() {
+        for (Shard& shard : shards) {
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            shard.index.clear();
+            for (Slot& slot : shard.slots)
+                slot.used = slot.referenced = false;
+            shard.hand = 0;
+        }
+    }
+
+    EvalCacheStats stats() const {
+        EvalCacheStats result;
+        result.hits = hits.load(std::memory_order_relaxed);
+        result.misses = misses.load(std::memory_order_relaxed);
+        result.inserts = inserts.load(std::memory_order_relaxed);
+        result.evictions = evictions.load(std::memory_order_relaxed);
+        return result;
+    }
+
+private:
+    static constexpr size_t ShardCount = 64;
+
+    struct Slot {
+        uint64_t key = 0;
+        uint64_t version = 0;
+        bool used = false;
+        bool referenced = false;
+        std::array<float, OutputSize> output;
+    };
+
+    struct Shard {
+        std::mutex mutex;
+        std::unordered_map<uint64_t, size_t> index;
+        std::vector<Slot> slots;
+        size_t hand = 0;
+    };
+
+    Shard shards[ShardCount];
+    std::atomic<uint64_t> hits{ 0 };
+    std::atomic<uint64_t> misses{ 0 };
+    std::atomic<uint64_t> inserts{ 0 };
+    std::atomic<uint64_t> evictions{ 0 };
+
+    static uint64_t combine(uint64_t key, uint64_t version) {
+        return key ^ splitMix64(version);
+    }
+
+    Shard& shardFor(uint64_t key, uint64_t version) {
+        return shards[(combine(key, version) >> 58) % ShardCount];
+    }
+};
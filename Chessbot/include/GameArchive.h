@@ -0,0 +1,370 @@
+#pragma once
+#include <ChessBoard.h>
+#include <MappedFile.h>
+#include <Profiler.h>
+#include <SelfPlay.h>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <filesystem>
+#include <mutex>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+// Archive layout: per shard, <directory>/shard<N>.games holds the games back to back and
+// <directory>/shard<N>.index holds one uint64 byte offset per game. Each game is an
+// ArchivedGameHeader, the result string, then one packMove value per ply.
+struct ArchivedGameHeader {
+    uint64_t gameIndex;
+    uint64_t seed;
+    uint32_t plies;
+    uint8_t outcome;       // GameOutcome
+    uint8_t resultLength;
+    uint16_t reserved;
+};
+static_assert(sizeof(ArchivedGameHeader) == 24, "ArchivedGameHeader must stay 24 bytes");
+
+// Appends game to out as an ArchivedGameHeader, the result string and the packed moves
+inline void serializeGame(const GameRecord& game, std::vector<uint8_t>& out) {
+    ArchivedGameHeader header = {};
+    header.gameIndex = game.index;
+    header.seed = game.seed;
+    header.plies = (uint32_t)game.moves.size();
+    header.outcome = (uint8_t)outcomeFromResult(game.result);
+    header.resultLength = (uint8_t)std::min<size_t>(game.result.size(), 255);
+
+    size_t start = out.size();
+    out.resize(start + sizeof(header) + header.resultLength + header.plies * sizeof(uint16_t));
+    uint8_t* bytes = out.data() + start;
+    std::memcpy(bytes, &header, sizeof(header));
+    std::memcpy(bytes + sizeof(header), game.result.data(), header.resultLength);
+    uint8_t* moves = bytes + sizeof(header) + header.resultLength;
+    for (size_t i = 0; i < game.moves.size(); ++i) {
+        uint16_t packed = packMove(game.moves[i]);
+        std::memcpy(moves + i * sizeof(uint16_t), &packed, sizeof(uint16_t));
+    }
+}
+
+// Reads one game written by serializeGame; returns the bytes it took up
+inline size_t deserializeGame(const uint8_t* data, GameRecord& record) {
+    ArchivedGameHeader header;
+    std::memcpy(&header, data, sizeof(header));
+    const uint8_t* payload = data + sizeof(header);
+
+    record.index = header.gameIndex;
+    record.seed = header.seed;
+    record.result.assign(reinterpret_cast<const char*>(payload), header.resultLength);
+    record.moves.resize(header.plies);
+    for (uint32_t i = 0; i < header.plies; ++i) {
+        uint16_t packed;
+        std::memcpy(&packed, payload + header.resultLength + i * sizeof(uint16_t), sizeof(packed));
+        record.moves[i] = unpackMove(packed);
+    }
+    return sizeof(header) + header.resultLength + header.plies * sizeof(uint16_t);
+}
+
+// Bytes the game serialized at data takes up according to its header, or 0 when that is more
+// than available, as for an index entry written past the end of a shard cut short by a crash
+inline size_t serializedGameSize(const uint8_t* data, size_t available) {
+    ArchivedGameHeader header;
+    if (available < sizeof(header)) return 0;
+    std::memcpy(&header, data, sizeof(header));
+    size_t size = sizeof(header) + header.resultLength + (size_t)header.plies * sizeof(uint16_t);
+    return size <= available ? size : 0;
+}
+
+inline std::string archiveShardPath(const std::string& directory, size_t shard) {
+    return directory + "/shard" + std::to_string(shard) + ".games";
+}
+
+inline std::string archiveIndexPath(const std::string& directory, size_t shard) {
+    return directory + "/shard" + std::to_string(shard) + ".index";
+}
+
+// Buffered, append-only writer with one shard per self-play worker. Games are serialized into
+// the shard's memory buffer on the calling thread; full buffers are handed to a background
+// thread that does the file I/O. Self-play threads only wait on the disk when it falls behind:
+// once maxQueuedJobs buffers are queued, the appending thread blocks, holding its shard, until
+// the writer catches up.
+class GameArchiveWriter {
+public:
+    GameArchiveWriter(const std::string& directory, size_t shardCount, size_t flushBytes = 1 << 20)
+        : directory(directory), flushBytes(flushBytes) {
+        std::filesystem::create_directories(directory);
+        for (size_t i = 0; i < shardCount; ++i) {
+            shards.emplace_back(new Shard());
+            Shard& shard = *shards.back();
+            shard.dataFile = std::fopen(archiveShardPath(directory, i).c_str(), "ab");
+            shard.indexFile = std::fopen(archiveIndexPath(directory, i).c_str(), "ab");
+            if (!shard.dataFile || !shard.indexFile) {
+                std::cerr << "Error: Could not open archive shard " << i << " in '" << directory << "'" << std::endl;
+                continue;
+            }
+            // Appending to an existing archive: offsets continue from the current end
+            std::fseek(shard.dataFile, 0, SEEK_END);
+            shard.offset = (uint64_t)std::ftell(shard.dataFile);
+        }
+        writer = std::thread([this] { writeLoop(); });
+    }
+
+    ~GameArchiveWriter() {
+        close();
+    }
+
+    GameArchiveWriter(const GameArchiveWriter&) = delete;
+    GameArchiveWriter& operator=(const GameArchiveWriter&) = delete;
+
+    size_t shardCount() const { return shards.size(); }
+
+    // Thread-safe. Callers should use their worker index as the shard so the lock is uncontended.
+    void append(size_t shardIndex, const GameRecord& game) {
+        Shard& shard = *shards[shardIndex % shards.size()];
+        std::unique_lock<std::mutex> lock(shard.mutex);
+
+        size_t start = shard.data.size();
+        serializeGame(game, shard.data);
+
+        const uint8_t* offsetBytes = reinterpret_cast<const uint8_t*>(&shard.offset);
+        shard.index.insert(shard.index.end(), offsetBytes, offsetBytes + sizeof(uint64_t));
+        shard.offset += shard.data.size() - start;
+
+        if (shard.data.size() >= flushBytes)
+            handOff(shardIndex % shards.size(), shard, lock);
+    }
+
+    // Blocks until everything appended so far is written to the files
+    void flush() {
+        for (size_t i = 0; i < shards.size(); ++i) {
+            std::unique_lock<std::mutex> lock(shards[i]->mutex);
+            handOff(i, *shards[i], lock);
+        }
+        std::unique_lock<std::mutex> lock(jobsMutex);
+        jobsDone.wait(lock, [this] { return jobs.empty() && writing == 0; });
+        for (auto& shard : shards) {
+            if (shard->dataFile) std::fflush(shard->dataFile);
+            if (shard->indexFile) std::fflush(shard->indexFile);
+        }
+    }
+
+    void close() {
+        if (!writer.joinable()) return;
+        flush();
+        {
+            std::lock_guard<std::mutex> lock(jobsMutex);
+            closing = true;
+        }
+        jobsReady.notify_all();
+        writer.join();
+        for (auto& shard : shards) {
+            if (shard->dataFile) std::fclose(shard->dataFile);
+            if (shard->indexFile) std::fclose(shard->indexFile);
+            shard->dataFile = shard->indexFile = nullptr;
+        }
+    }
+
+private:
+    struct Shard {
+        std::mutex mutex;
+        std::vector<uint8_t> data;
+        std::vector<uint8_t> index;
+        uint64_t offset = 0;
+        std::FILE* dataFile = nullptr;
+        std::FILE* indexFile = nullptr;
+    };
+
+    struct Job {
+        size_t shard;
+        std::vector<uint8_t> data;
+        std::vector<uint8_t> index;
+    };
+
+    static constexpr size_t maxQueuedJobs = 64;
+
+    std::string directory;
+    size_t flushBytes;
+    std::vector<std::unique_ptr<Shard>> shards;
+
+    std::mutex jobsMutex;
+    std::condition_variable jobsReady;
+    std::condition_variable jobsDone;
+    std::deque<Job> jobs;
+    size_t writing = 0;
+    bool closing = false;
+    std::thread writer;
+
+    // Called with the shard locked, which keeps the shard's jobs in append order
+    void handOff(size_t shardIndex, Shard& shard, std::unique_lock<std::mutex>&) {
+        if (shard.data.empty()) return;
+        Job job{ shardIndex, std::move(shard.data), std::move(shard.index) };
+        shard.data = std::vector<uint8_t>();
+        shard.index = std::vector<uint8_t>();
+        shard.data.reserve(flushBytes + 4096);
+
+        std::unique_lock<std::mutex> lock(jobsMutex);
+        jobsDone.wait(lock, [this] { return jobs.size() < maxQueuedJobs; });
+        jobs.push_back(std::move(job));
+        lock.unlock();
+        jobsReady.notify_one();
+    }
+
+    void writeLoop() {
+        std::unique_lock<std::mutex> lock(jobsMutex);
+        while (true) {
+            jobsReady.wait(lock, [this] { return closing || !jobs.empty(); });
+            if (jobs.empty() && closing) return;
+
+            Job job = std::move(jobs.front());
+            jobs.pop_front();
+            writing++;
+            lock.unlock();
+
+            Shard& shard = *shards[job.shard];
+            if (shard.dataFile && shard.indexFile) {
+                PROFILE_SCOPE(ProfileZone::FileIO);
+                PROFILE_COUNT(ProfileZone::FileIO, job.data.size() + job.index.size());
+                std::fwrite(job.data.data(), 1, job.data.size(), shard.dataFile);
+                std::fwrite(job.index.data(), 1, job.index.size(), shard.indexFile);
+            }
+
+            lock.lock();
+            writing--;
+            jobsDone.notify_all();
+        }
+    }
+};
+
+// Standard algebraic notation for PGN export. This variant has no castling or en passant and
+// always promotes to a queen.
+inline std::string toStandardSAN(const ChessBoard& board, const Move& move) {
+    Piece moving = board.getPiece(move.from.row, move.from.col);
+    bool whiteMoving = board.isWhitePiece(moving);
+    bool capture = board.getPiece(move.to.row, move.to.col) != Piece::Empty;
+    std::string san;
+
+    if (moving == Piece::WhitePawn || moving == Piece::BlackPawn) {
+        if (capture) {
+            san += (char)('a' + move.from.col);
+            san += 'x';
+        }
+        san += board.coordToStr(move.to);
+        if (move.to.row == 7 || move.to.row == 0) san += "=Q";
+    }
+    else {
+        const char letters[] = " PRNBQKPRNBQK";
+        san += letters[(int)moving];
+
+        // Disambiguate against other pieces of the same kind that can reach the same square
+        bool ambiguous = false, sameCol = false, sameRow = false;
+        for (int r = 0; r < 8; ++r) {
+            for (int c = 0; c < 8; ++c) {
+                if (board.board[r][c] != moving || (r == move.from.row && c == move.from.col)) continue;
+                if (!board.getValidMoves({ r, c })[move.to.row][move.to.col]) continue;
+                ambiguous = true;
+                if (c == move.from.col) sameCol = true;
+                if (r == move.from.row) sameRow = true;
+            }
+        }
+        if (ambiguous) {
+            if (!sameCol) san += (char)('a' + move.from.col);
+            else if (!sameRow) san += (char)('1' + move.from.row);
+            else san += board.coordToStr(move.from);
+        }
+
+        if (capture) san += 'x';
+        san += board.coordToStr(move.to);
+    }
+
+    ChessBoard after = board;
+    after.makeMove(move);
+    if (after.isInCheck(!whiteMoving)) {
+        san += after.hasLegalMoves(!whiteMoving) ? '+' : '#';
+    }
+    return san;
+}
+
+// Random access to every game in an archive directory through the offset indexes
+class GameArchiveReader {
+public:
+    explicit GameArchiveReader(const std::string& directory) {
+        for (size_t shard = 0; std::filesystem::exists(archiveShardPath(directory, shard)); ++shard) {
+            ShardView view;
+            view.data.open(archiveShardPath(directory, shard), MappedFile::Access::Random);
+            view.index.open(archiveIndexPath(directory, shard), MappedFile::Access::Random);
+            view.games = view.index.size() / sizeof(uint64_t);
+            view.firstGame = total;
+            total += view.games;
+            shards.push_back(std::move(view));
+        }
+    }
+
+    size_t gameCount() const { return total; }
+
+    // Game n in shard order (shard 0's games first); throws std::out_of_range past gameCount(),
+    // and std::runtime_error for a game the index places beyond the end of its shard
+    GameRecord game(size_t n) const {
+        if (n >= total)
+            throw std::out_of_range("GameArchiveReader: game " + std::to_string(n) + " of " + std::to_string(total));
+        GameRecord record;
+        for (const ShardView& shard : shards) {
+            if (n >= shard.firstGame + shard.games) continue;
+
+            uint64_t offset;
+            std::memcpy(&offset, shard.index.data() + (n - shard.firstGame) * sizeof(uint64_t), sizeof(offset));
+            size_t available = offset < shard.data.size() ? shard.data.size() - (size_t)offset : 0;
+            if (serializedGameSize(shard.data.data() + offset, available) == 0)
+                throw std::runtime_error("GameArchiveReader: game " + std::to_string(n) + " is truncated");
+            deserializeGame(shard.data.data() + offset, record);
+            break;
+        }
+        return record;
+    }
+
+    // Same format as writeVectorToFile: one toSAN move per line
+    void exportLAN(size_t n, std::ostream& out) const {
+        GameRecord record = game(n);
+        ChessBoard board;
+        for (const Move& move : record.moves) {
+            out << board.toSAN(move.from, move.to) << "\n";
+            board.makeMove(move);
+        }
+    }
+
+    void exportPGN(size_t n, std::ostream& out) const {
+        GameRecord record = game(n);
+        GameOutcome outcome = outcomeFromResult(record.result);
+        const char* result = outcome == GameOutcome::WhiteWins ? "1-0"
+                           : outcome == GameOutcome::BlackWins ? "0-1"
+                           : outcome == GameOutcome::Draw ? "1/2-1/2" : "*";
+
+        out << "[Event \"Chessbot self-play\"]\n"
+            << "[Site \"?\"]\n"
+            << "[Date \"????.??.??\"]\n"
+            << "[Round \"" << record.index << "\"]\n"
+            << "[White \"Chessbot\"]\n"
+            << "[Black \"Chessbot\"]\n"
+            << "[Result \"" << result << "\"]\n"
+            << "[Termination \"" << record.result << "\"]\n\n";
+
+        ChessBoard board;
+        for (size_t i = 0; i < record.moves.size(); ++i) {
+            if (i % 2 == 0) out << (i / 2 + 1) << ". ";
+            out << toStandardSAN(board, record.moves[i]) << ((i % 16 == 15) ? "\n" : " ");
+            board.makeMove(record.moves[i]);
+        }
+        out << result << "\n\n";
+    }
+
+private:
+    struct ShardView {
+        MappedFile data;
+        MappedFile index;
+        size_t games = 0;
+        size_t firstGame = 0;
+    };
+
+    std::vector<ShardView> shards;
+    size_t total = 0;
+};
@@ -0,0 +1,173 @@
+#pragma once
+#include <GameArchive.h>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+// Finished games streamed from self-play worker processes to one coordinator over a Unix
+// domain socket. Each message is a uint32 length followed by the game in the archive's form
+// (see serializeGame).
+class GameStreamServer {
+public:
+    using GameCallback = std::function<void(const GameRecord& game)>;
+
+    explicit GameStreamServer(const std::string& path) : path(path) {
+        sockaddr_un address;
+        if (!makeAddress(path, address)) return;
+        unlink(path.c_str());
+        listener = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (listener < 0 || bind(listener, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 ||
+            listen(listener, 64) != 0) {
+            std::cerr << "Error: Could not listen on '" << path << "'" << std::endl;
+            closeListener();
+            return;
+        }
+        fcntl(listener, F_SETFL, O_NONBLOCK);
+    }
+
+    ~GameStreamServer() {
+        for (Client& client : clients)
+            ::close(client.fd);
+        if (listener >= 0) unlink(path.c_str());
+        closeListener();
+    }
+
+    GameStreamServer(const GameStreamServer&) = delete;
+    GameStreamServer& operator=(const GameStreamServer&) = delete;
+
+    bool isOpen() const { return listener >= 0; }
+    size_t clientCount() const { return clients.size(); }
+
+    // Accepts new workers and passes every complete game received to onGame, waiting up to
+    // timeoutMillis for activity; returns the number of games received
+    size_t poll(int timeoutMillis, const GameCallback& onGame) {
+        std::vector<pollfd> fds;
+        fds.push_back({ listener, POLLIN, 0 });
+        for (const Client& client : clients)
+            fds.push_back({ client.fd, POLLIN, 0 });
+        if (::poll(fds.data(), fds.size(), timeoutMillis) <= 0) return 0;
+
+        size_t games = 0;
+        for (size_t i = clients.size(); i-- > 0;) {
+            if (!fds[i + 1].revents) continue;
+            if (!receive(clients[i], onGame, games)) {
+                ::close(clients[i].fd);
+                clients.erase(clients.begin() + i);
+            }
+        }
+        if (fds[0].revents & POLLIN) {
+            int fd;
+            while ((fd = accept(listener, nullptr, nullptr)) >= 0)
+                clients.push_back({ fd, {} });
+        }
+        return games;
+    }
+
+private:
+    struct Client {
+        int fd;
+        std::vector<uint8_t> pending; // bytes of a partially received message
+    };
+
+    std::string path;
+    int listener = -1;
+    std::vector<Client> clients;
+    GameRecord record;
+
+    // false once the worker has disconnected
+    bool receive(Client& client, const GameCallback& onGame, size_t& games) {
+        uint8_t chunk[1 << 16];
+        ssize_t received = recv(client.fd, chunk, sizeof(chunk), 0);
+        if (received <= 0) return false;
+        client.pending.insert(client.pending.end(), chunk, chunk + received);
+
+        size_t offset = 0;
+        uint32_t length;
+        while (client.pending.size() - offset >= sizeof(length)) {
+            std::memcpy(&length, client.pending.data() + offset, sizeof(length));
+            if (client.pending.size() - offset - sizeof(length) < length) break;
+            deserializeGame(client.pending.data() + offset + sizeof(length), record);
+            offset += sizeof(length) + length;
+            if (onGame) onGame(record);
+            games++;
+        }
+        client.pending.erase(client.pending.begin(), client.pending.begin() + offset);
+        return true;
+    }
+
+    void closeListener() {
+        if (listener >= 0) ::close(listener);
+        listener = -1;
+    }
+
+    static bool makeAddress(const std::string& path, sockaddr_un& address) {
+        std::memset(&address, 0, sizeof(address));
+        address.sun_family = AF_UNIX;
+        if (path.size() >= sizeof(address.sun_path)) {
+            std::cerr << "Error: Socket path '" << path << "' is too long" << std::endl;
+            return false;
+        }
+        std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+        return true;
+    }
+
+    friend class GameStreamClient;
+};
+
+class GameStreamClient {
+public:
+    explicit GameStreamClient(const std::string& path) {
+        sockaddr_un address;
+        if (!GameStreamServer::makeAddress(path, address)) return;
+        fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd >= 0 && connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0) {
+            std::cerr << "Error: Could not connect to '" << path << "'" << std::endl;
+            close();
+        }
+    }
+
+    ~GameStreamClient() {
+        close();
+    }
+
+    GameStreamClient(const GameStreamClient&) = delete;
+    GameStreamClient& operator=(const GameStreamClient&) = delete;
+
+    bool isOpen() const { return fd >= 0; }
+
+    // Blocks until the whole message is written; false once the coordinator has gone away
+    bool send(const GameRecord& game) {
+        message.assign(sizeof(uint32_t), 0);
+        serializeGame(game, message);
+        uint32_t length = (uint32_t)(message.size() - sizeof(uint32_t));
+        std::memcpy(message.data(), &length, sizeof(length));
+
+        size_t sent = 0;
+        while (sent < message.size()) {
+            ssize_t written = ::send(fd, message.data() + sent, message.size() - sent, MSG_NOSIGNAL);
+            if (written <= 0) return false;
+            sent += (size_t)written;
+        }
+        return true;
+    }
+
+    void close() {
+        if (fd >= 0) ::close(fd);
+        fd = -1;
+    }
+
+private:
+    int fd = -1;
+    std::vector<uint8_t> message;
+};
+#endif
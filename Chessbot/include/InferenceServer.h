@@ -0,0 +1,392 @@
+#pragma once
+#include <NeuralNetwork.h>
+#include <ThreadPool.h>
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+struct InferenceConfig {
+    size_t maxBatch = 32;           // samples per forwardBatch call
+    double maxLatencyMillis = 1.0;  // a request waits at most this long for others to share its batch
+    size_t threads = std::max(1u, std::thread::hardware_concurrency());
+    size_t maxRequestSamples = 4096;
+    double writeTimeoutMillis = 1000.0; // a client that reads none of its answer for this long is dropped
+};
+
+// One network evaluating positions for many local clients over a Unix domain socket. Requests
+// are gathered into batches of up to maxBatch samples; a batch is run as soon as it is full or
+// its oldest request has waited maxLatencyMillis, on a pool of threads sharing the network.
+//
+// On connecting, a client receives the network's input and output sizes as two uint32. A
+// request is a uint32 sample count followed by that many inputs of inputSize floats, and is
+// answered with as many outputs of outputSize floats. A request is never split across batches.
+// Each connection has one request in flight at a time: a connection isn't read while its answer
+// is pending, so requests a client pipelines wait their turn. Clients wanting more in flight open
+// more connections.
+// A client that stops reading is disconnected after writeTimeoutMillis rather than holding a pool
+// thread.
+class InferenceServer {
+public:
+    struct Counters {
+        std::atomic<size_t> requests{ 0 };
+        std::atomic<size_t> samples{ 0 };
+        std::atomic<size_t> batches{ 0 };
+    };
+
+    InferenceServer(const std::string& path, const NeuralNetwork& network, const InferenceConfig& config = InferenceConfig())
+        : path(path), network(network), config(config), pool(std::max<size_t>(config.threads, 1)) {
+        sockaddr_un address;
+        if (!makeAddress(path, address)) return;
+        unlink(path.c_str());
+        listener = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (listener < 0 || bind(listener, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 ||
+            listen(listener, 128) != 0) {
+            std::cerr << "Error: Could not listen on '" << path << "'" << std::endl;
+            closeListener();
+            return;
+        }
+        fcntl(listener, F_SETFL, O_NONBLOCK);
+        if (pipe(wakePipe) != 0) {
+            std::cerr << "Error: Could not create a pipe" << std::endl;
+            closeListener();
+            return;
+        }
+        fcntl(wakePipe[0], F_SETFL, O_NONBLOCK);
+        fcntl(wakePipe[1], F_SETFL, O_NONBLOCK);
+    }
+
+    ~InferenceServer() {
+        stop();
+        if (listener >= 0) unlink(path.c_str());
+        closeListener();
+        for (int fd : wakePipe)
+            if (fd >= 0) ::close(fd);
+    }
+
+    InferenceServer(const InferenceServer&) = delete;
+    InferenceServer& operator=(const InferenceServer&) = delete;
+
+    bool isOpen() const { return listener >= 0; }
+    const Counters& counters() const { return stats; }
+
+    double meanBatchSize() const {
+        return stats.batches ? (double)stats.samples / stats.batches : 0.0;
+    }
+
+    void start() {
+        if (!isOpen() || ioThread.joinable()) return;
+        stopping = false;
+        ioThread = std::thread([this] { serve(); });
+    }
+
+    // Stops accepting requests and shuts down every connection. Requests already received are
+    // still evaluated, but answers not written by then are lost, so a stalled client can't hold
+    // stop up.
+    void stop() {
+        stopping = true;
+        if (ioThread.joinable()) ioThread.join();
+        for (const auto& connection : connections)
+            shutdown(connection->fd, SHUT_RDWR);
+        pool.waitIdle();
+        connections.clear();
+    }
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    struct Connection {
+        int fd;
+        std::vector<uint8_t> pending; // received bytes not yet queued as a request
+        std::atomic<bool> inFlight{ false }; // a request is queued or being answered
+
+        explicit Connection(int fd) : fd(fd) {}
+        ~Connection() { ::close(fd); }
+    };
+
+    struct Request {
+        std::shared_ptr<Connection> connection; // kept open until the answer is written
+        uint32_t count;
+        std::vector<float> inputs;
+        Clock::time_point deadline;
+    };
+
+    std::string path;
+    NeuralNetwork network;
+    InferenceConfig config;
+    ThreadPool pool;
+    int listener = -1;
+    int wakePipe[2] = { -1, -1 }; // written by the pool when an answer is out, waking the I/O thread
+    std::thread ioThread;
+    std::atomic<bool> stopping{ false };
+    Counters stats;
+    // Only touched by the I/O thread
+    std::vector<std::shared_ptr<Connection>> connections;
+    std::deque<Request> queue;
+    size_t queuedSamples = 0;
+
+    void serve() {
+        while (!stopping) {
+            // Sleep until the oldest request is due, checking for stop now and then
+            int timeout = 50;
+            if (!queue.empty()) {
+                double millis = std::chrono::duration<double, std::milli>(queue.front().deadline - Clock::now()).count();
+                timeout = (int)std::min(std::max(std::ceil(millis), 0.0), 50.0);
+            }
+            receive(timeout);
+            dispatch(false);
+        }
+        dispatch(true);
+    }
+
+    void receive(int timeoutMillis) {
+        std::vector<pollfd> fds;
+        fds.push_back({ listener, POLLIN, 0 });
+        fds.push_back({ wakePipe[0], POLLIN, 0 });
+        for (const auto& connection : connections)
+            fds.push_back({ connection->fd, (short)(connection->inFlight ? 0 : POLLIN), 0 });
+        if (::poll(fds.data(), fds.size(), timeoutMillis) <= 0) return;
+
+        if (fds[1].revents & POLLIN) {
+            // Answers went out: queue the next request of connections that had one buffered
+            char drain[256];
+            while (::read(wakePipe[0], drain, sizeof(drain)) > 0) {}
+            for (size_t i = connections.size(); i-- > 0;) {
+                if (!connections[i]->inFlight && !parse(connections[i])) connections.erase(connections.begin() + i);
+            }
+        }
+        for (size_t i = connections.size(); i-- > 0;) {
+            if (fds[i + 2].revents && !read(connections[i])) connections.erase(connections.begin() + i);
+        }
+        if (fds[0].revents & POLLIN) {
+            int fd;
+            while ((fd = accept(listener, nullptr, nullptr)) >= 0) {
+                auto connection = std::make_shared<Connection>(fd);
+                fcntl(fd, F_SETFL, O_NONBLOCK);
+                uint32_t sizes[2] = { (uint32_t)network.inputSize, (uint32_t)network.outputSize };
+                if (writeAll(fd, sizes, sizeof(sizes), config.writeTimeoutMillis)) connections.push_back(connection);
+            }
+        }
+    }
+
+    // false once the client has disconnected or sent a malformed request
+    bool read(const std::shared_ptr<Connection>& connection) {
+        uint8_t chunk[1 << 16];
+        ssize_t received = recv(connection->fd, chunk, sizeof(chunk), 0);
+        if (received <= 0) return received < 0 && (errno == EAGAIN || errno == EWOULDBLOCK);
+        connection->pending.insert(connection->pending.end(), chunk, chunk + received);
+        return parse(connection);
+    }
+
+    // Queues the connection's first complete request, if it has none in flight. Later ones stay
+    // in pending until the answer is written. false for a malformed request.
+    bool parse(const std::shared_ptr<Connection>& connection) {
+        std::vector<uint8_t>& pending = connection->pending;
+        uint32_t count;
+        if (connection->inFlight || pending.size() < sizeof(count)) return true;
+        std::memcpy(&count, pending.data(), sizeof(count));
+        if (count == 0 || count > config.maxRequestSamples) return false;
+        size_t bytes = (size_t)count * network.inputSize * sizeof(float);
+        if (pending.size() - sizeof(count) < bytes) return true;
+
+        Request request{ connection, count, std::vector<float>((size_t)count * network.inputSize),
+                         Clock::now() + std::chrono::duration_cast<Clock::duration>(
+                             std::chrono::duration<double, std::milli>(config.maxLatencyMillis)) };
+        std::memcpy(request.inputs.data(), pending.data() + sizeof(count), bytes);
+        pending.erase(pending.begin(), pending.begin() + sizeof(count) + bytes);
+        connection->inFlight = true;
+        queuedSamples += count;
+        queue.push_back(std::move(request));
+        return true;
+    }
+
+    // Hands full or overdue batches to the pool, or everything queued when flushing
+    void dispatch(bool flush) {
+        Clock::time_point now = Clock::now();
+        while (!queue.empty() && (flush || queuedSamples >= config.maxBatch || now >= queue.front().deadline)) {
+            auto batch = std::make_shared<std::vector<Request>>();
+            size_t samples = 0;
+            while (!queue.empty() && (batch->empty() || samples + queue.front().count <= config.maxBatch)) {
+                samples += queue.front().count;
+                batch->push_back(std::move(queue.front()));
+                queue.pop_front();
+            }
+            queuedSamples -= samples;
+            pool.submit([this, batch, samples](size_t) { evaluate(*batch, samples); });
+        }
+    }
+
+    void evaluate(const std::vector<Request>& batch, size_t samples) {
+        const size_t inputSize = network.inputSize, outputSize = network.outputSize;
+        Matrix inputs(inputSize, samples);
+        size_t column = 0;
+        for (const Request& request : batch) {
+            for (uint32_t s = 0; s < request.count; ++s, ++column) {
+                const float* input = request.inputs.data() + s * inputSize;
+                for (size_t k = 0; k < inputSize; ++k)
+                    inputs.data[k][column] = input[k];
+            }
+        }
+        Matrix outputs = network.forwardBatch(inputs);
+
+        std::vector<float> answer;
+        column = 0;
+        for (const Request& request : batch) {
+            answer.resize((size_t)request.count * outputSize);
+            for (uint32_t s = 0; s < request.count; ++s, ++column) {
+                for (size_t k = 0; k < outputSize; ++k)
+                    answer[s * outputSize + k] = outputs.data[k][column];
+            }
+            // A client that has gone away just misses its answer. One that stopped reading is left
+            // with part of it, so the connection is shut down and the I/O thread drops it.
+            if (!writeAll(request.connection->fd, answer.data(), answer.size() * sizeof(float), config.writeTimeoutMillis))
+                shutdown(request.connection->fd, SHUT_RDWR);
+            request.connection->inFlight = false;
+            char wake = 0;
+            (void)!::write(wakePipe[1], &wake, 1); // a full pipe already wakes it
+        }
+        stats.requests += batch.size();
+        stats.samples += samples;
+        stats.batches++;
+    }
+
+    // Blocks until everything is written, also on a non-blocking socket. On a non-blocking one it
+    // gives up once stallMillis pass without a byte going out; 0 waits forever.
+    static bool writeAll(int fd, const void* data, size_t size, double stallMillis = 0.0) {
+        const uint8_t* bytes = static_cast<const uint8_t*>(data);
+        size_t sent = 0;
+        Clock::time_point progress = Clock::now();
+        while (sent < size) {
+            ssize_t written = ::send(fd, bytes + sent, size - sent, MSG_NOSIGNAL);
+            if (written < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+                double stalled = std::chrono::duration<double, std::milli>(Clock::now() - progress).count();
+                if (stallMillis > 0.0 && stalled >= stallMillis) return false;
+                pollfd wait = { fd, POLLOUT, 0 };
+                ::poll(&wait, 1, 100);
+                continue;
+            }
+            if (written <= 0) return false;
+            sent += (size_t)written;
+            progress = Clock::now();
+        }
+        return true;
+    }
+
+    void closeListener() {
+        if (listener >= 0) ::close(listener);
+        listener = -1;
+    }
+
+    static bool makeAddress(const std::string& path, sockaddr_un& address) {
+        std::memset(&address, 0, sizeof(address));
+        address.sun_family = AF_UNIX;
+        if (path.size() >= sizeof(address.sun_path)) {
+            std::cerr << "Error: Socket path '" << path << "' is too long" << std::endl;
+            return false;
+        }
+        std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+        return true;
+    }
+
+    friend class InferenceClient;
+};
+
+// Evaluates positions on an InferenceServer in place of a local network: forward and
+// forwardBatch take and return the same matrices as NeuralNetwork's, up to rounding in the
+// final softmax. One client per thread.
+class InferenceClient {
+public:
+    size_t inputSize = 0;
+    size_t outputSize = 0;
+
+    explicit InferenceClient(const std::string& path) {
+        sockaddr_un address;
+        if (!InferenceServer::makeAddress(path, address)) return;
+        fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        uint32_t sizes[2];
+        if (fd >= 0 && (connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 ||
+                        !readAll(sizes, sizeof(sizes)))) {
+            std::cerr << "Error: Could not connect to '" << path << "'" << std::endl;
+            close();
+            return;
+        }
+        inputSize = sizes[0];
+        outputSize = sizes[1];
+    }
+
+    ~InferenceClient() {
+        close();
+    }
+
+    InferenceClient(const InferenceClient&) = delete;
+    InferenceClient& operator=(const InferenceClient&) = delete;
+
+    bool isOpen() const { return fd >= 0; }
+
+    // An empty matrix once the server has gone away, after which isOpen() is false
+    Matrix forward(const Matrix& input) {
+        return forwardBatch(input);
+    }
+
+    // Column j of inputs is one sample, column j of the result its output
+    Matrix forwardBatch(const Matrix& inputs) {
+        assert(inputs.rows == inputSize);
+        uint32_t count = (uint32_t)inputs.cols;
+        message.resize(1 + (size_t)count * inputSize);
+        std::memcpy(message.data(), &count, sizeof(count));
+        for (size_t j = 0; j < count; ++j)
+            for (size_t k = 0; k < inputSize; ++k)
+                message[1 + j * inputSize + k] = inputs.data[k][j];
+
+        answer.resize((size_t)count * outputSize);
+        if (!isOpen() || !InferenceServer::writeAll(fd, message.data(), message.size() * sizeof(float)) ||
+            !readAll(answer.data(), answer.size() * sizeof(float))) {
+            close();
+            return Matrix();
+        }
+        Matrix outputs(outputSize, count);
+        for (size_t j = 0; j < count; ++j)
+            for (size_t k = 0; k < outputSize; ++k)
+                outputs.data[k][j] = answer[j * outputSize + k];
+        return outputs;
+    }
+
+    void close() {
+        if (fd >= 0) ::close(fd);
+        fd = -1;
+    }
+
+private:
+    int fd = -1;
+    std::vector<float> message; // the count, then the inputs; both 4 bytes wide
+    std::vector<float> answer;
+
+    bool readAll(void* data, size_t size) {
+        uint8_t* bytes = static_cast<uint8_t*>(data);
+        size_t received = 0;
+        while (received < size) {
+            ssize_t got = recv(fd, bytes + received, size - received, 0);
+            if (got <= 0) return false;
+            received += (size_t)got;
+        }
+        return true;
+    }
+};
+#endif
@@ -0,0 +1,410 @@
+#pragma once
+#include <RandomPlayout.h>
+#include <Search.h>
+#include <ThreadPool.h>
+#include <atomic>
+#include <cmath>
+#include <functional>
+#include <memory>
+#include <thread>
+
+struct MCTSConfig {
+    size_t threads = 1;
+    size_t batchSize = 16;      // leaves each thread gathers per forwardBatch call
+    float cpuct = 1.5f;
+    size_t nodeCapacity = 1 << 20;
+    size_t rolloutPlies = 0;    // 0 scores leaves by material, otherwise by a random playout this long
+    float uniformPrior = 0.1f;  // share of each node's priors spread evenly over its moves
+};
+
+struct MCTSLimits {
+    uint64_t maxPlayouts = 800;
+    double maxMillis = 0.0;     // 0 = no limit
+};
+
+struct MCTSResult {
+    SquareMove bestMove;
+    bool hasMove = false;
+    float value = 0.f;          // root value for the side to move, in [-1, 1]
+    uint64_t playouts = 0;
+    uint64_t evaluations = 0;   // leaves sent through the network
+    uint64_t batches = 0;
+    uint64_t collisions = 0;    // descents that hit a leaf already waiting for evaluation
+    uint32_t reusedVisits = 0;  // visits carried over from the previous search's tree
+    double seconds = 0.0;
+};
+
+// One tree node; children of a node are contiguous in the pool. value is from the point of view
+// of the player who made move, so a parent picks the child with the best value.
+struct MCTSNode {
+    enum State : uint8_t { Unexpanded, Pending, Expanded, Terminal };
+
+    SquareMove move;
+    uint16_t childCount = 0;
+    uint32_t firstChild = 0;
+    float prior = 0.f;
+    float terminalValue = 0.f;
+    std::atomic<uint32_t> visits{ 0 };
+    std::atomic<int32_t> virtualLoss{ 0 };
+    std::atomic<float> valueSum{ 0.f };
+    std::atomic<uint8_t> state{ Unexpanded };
+};
+
+// PUCT search over the network's from/to policy. Search threads descend in parallel with
+// virtual loss steering them apart; each gathers up to batchSize unexpanded leaves into a
+// pending batch that is evaluated with a single forwardBatch call before the leaves are
+// expanded and backed up. The tree is kept between searches, and when the next root is the
+// current root or a child or grandchild of it, that subtree is compacted and reused.
+class MCTS {
+public:
+    MCTS(const NeuralNetwork& network, const MCTSConfig& config)
+        : network(network), config(config), pool(std::max<size_t>(config.threads, 1)),
+          nodes(new MCTSNode[config.nodeCapacity]), spare(new MCTSNode[config.nodeCapacity]) {}
+
+    MCTSResult search(const Position& root, const MCTSLimits& limits) {
+        MCTSResult result;
+        result.reusedVisits = reuseTree(root);
+
+        playouts = 0;
+        evaluations = 0;
+        batches = 0;
+        collisions = 0;
+        full = false;
+        this->limits = limits;
+        start = std::chrono::steady_clock::now();
+
+        for (size_t i = 0; i < pool.size(); ++i)
+            pool.submit([this](size_t) { searchThread(); });
+        pool.waitIdle();
+
+        const MCTSNode& rootNode = nodes[0];
+        uint32_t bestVisits = 0;
+        for (uint32_t i = 0; i < rootNode.childCount; ++i) {
+            const MCTSNode& child = nodes[rootNode.firstChild + i];
+            if (!result.hasMove || child.visits > bestVisits) {
+                bestVisits = child.visits;
+                result.bestMove = child.move;
+                result.hasMove = true;
+            }
+        }
+        uint32_t rootVisits = rootNode.visits;
+        result.value = rootVisits ? -rootNode.valueSum / rootVisits : 0.f;
+        result.playouts = playouts;
+        result.evaluations = evaluations;
+        result.batches = batches;
+        result.collisions = collisions;
+        result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        return result;
+    }
+
+    void clear() {
+        hasTree = false;
+    }
+
+    size_t nodesUsed() const { return used; }
+
+private:
+    struct Leaf {
+        uint32_t node;
+        std::vector<uint32_t> path;
+        MoveList moves;
+        float value;
+        bool whiteToMove; // the network's outputs are from this side's perspective
+    };
+
+    const NeuralNetwork& network;
+    MCTSConfig config;
+    ThreadPool pool;
+    std::unique_ptr<MCTSNode[]> nodes;
+    std::unique_ptr<MCTSNode[]> spare;
+    std::atomic<uint32_t> used{ 0 };
+    Position rootPosition;
+    bool hasTree = false;
+
+    MCTSLimits limits;
+    std::chrono::steady_clock::time_point start;
+    std::atomic<uint64_t> playouts{ 0 };
+    std::atomic<uint64_t> evaluations{ 0 };
+    std::atomic<uint64_t> batches{ 0 };
+    std::atomic<uint64_t> collisions{ 0 };
+    std::atomic<bool> full{ false };
+
+    static bool samePosition(const Position& a, const Position& b) {
+        return a.squares == b.squares && a.whiteToMove == b.whiteToMove &&
+               a.movesSinceCapture == b.movesSinceCapture && a.movesSincePawnMovement == b.movesSincePawnMovement;
+    }
+
+    static void resetNode(MCTSNode& node) {
+        node.move = {};
+        node.childCount = 0;
+        node.firstChild = 0;
+        node.prior = 0.f;
+        node.terminalValue = 0.f;
+        node.visits = 0;
+        node.virtualLoss = 0;
+        node.valueSum = 0.f;
+        node.state = MCTSNode::Unexpanded;
+    }
+
+    // Makes root the tree's root, keeping the matching subtree if there is one. Returns its visits.
+    uint32_t reuseTree(const Position& root) {
+        uint32_t newRoot = UINT32_MAX;
+        if (hasTree) {
+            if (samePosition(rootPosition, root)) newRoot = 0;
+            else newRoot = findDescendant(0, rootPosition, root, 2);
+        }
+
+        if (newRoot == UINT32_MAX) {
+            resetNode(nodes[0]);
+            used = 1;
+        }
+        else if (newRoot != 0) {
+            compact(newRoot);
+        }
+        rootPosition = root;
+        hasTree = true;
+        return nodes[0].visits;
+    }
+
+    uint32_t findDescendant(uint32_t index, const Position& position, const Position& target, int depth) const {
+        const MCTSNode& node = nodes[index];
+        if (depth == 0 || node.state != MCTSNode::Expanded) return UINT32_MAX;
+        for (uint32_t i = 0; i < node.childCount; ++i) {
+            Position next = position;
+            next.makeMove(nodes[node.firstChild + i].move);
+            if (samePosition(next, target)) return node.firstChild + i;
+            uint32_t found = findDescendant(node.firstChild + i, next, target, depth - 1);
+            if (found != UINT32_MAX) return found;
+        }
+        return UINT32_MAX;
+    }
+
+    // Copies the subtree under newRoot to the front of the spare pool breadth-first, so every
+    // child block stays contiguous, then swaps pools
+    void compact(uint32_t newRoot) {
+        auto copyNode = [](const MCTSNode& from, MCTSNode& to) {
+            to.move = from.move;
+            to.childCount = from.childCount;
+            to.prior = from.prior;
+            to.terminalValue = from.terminalValue;
+            to.visits = from.visits.load();
+            to.virtualLoss = 0;
+            to.valueSum = from.valueSum.load();
+            to.state = from.state.load();
+        };
+
+        std::vector<std::pair<uint32_t, uint32_t>> queue = { { newRoot, 0 } };
+        copyNode(nodes[newRoot], spare[0]);
+        uint32_t next = 1;
+        for (size_t head = 0; head < queue.size(); ++head) {
+            const MCTSNode& from = nodes[queue[head].first];
+            MCTSNode& to = spare[queue[head].second];
+            to.firstChild = next;
+            if (from.state != MCTSNode::Expanded) {
+                to.childCount = 0;
+                if (from.state == MCTSNode::Pending) to.state = MCTSNode::Unexpanded;
+                continue;
+            }
+            for (uint32_t i = 0; i < from.childCount; ++i) {
+                copyNode(nodes[from.firstChild + i], spare[next + i]);
+                queue.push_back({ from.firstChild + i, next + i });
+            }
+            next += from.childCount;
+        }
+        std::swap(nodes, spare);
+        used = next;
+    }
+
+    bool outOfBudget() const {
+        if (full) return true;
+        if (playouts >= limits.maxPlayouts) return true;
+        return limits.maxMillis > 0.0 &&
+               std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() >= limits.maxMillis;
+    }
+
+    static void addValue(std::atomic<float>& sum, float value) {
+        float current = sum.load(std::memory_order_relaxed);
+        while (!sum.compare_exchange_weak(current, current + value, std::memory_order_relaxed)) {}
+    }
+
+    // value is for the side to move at the end of path
+    void backup(const std::vector<uint32_t>& path, float value) {
+        for (size_t i = path.size(); i-- > 0;) {
+            MCTSNode& node = nodes[path[i]];
+            value = -value;
+            addValue(node.valueSum, value);
+            node.visits.fetch_add(1, std::memory_order_relaxed);
+            node.virtualLoss.fetch_sub(1, std::memory_order_relaxed);
+        }
+        playouts++;
+    }
+
+    void revertVirtualLoss(const std::vector<uint32_t>& path) {
+        for (uint32_t index : path)
+            nodes[index].virtualLoss.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+    // Unvisited children start at the parent's own value rather than 0, so a node that is
+    // already winning still tries its other moves
+    uint32_t selectChild(const MCTSNode& node) const {
+        uint32_t parentVisits = node.visits.load(std::memory_order_relaxed);
+        float firstPlay = parentVisits ? -node.valueSum.load(std::memory_order_relaxed) / parentVisits : 0.f;
+        float sqrtParent = std::sqrt((float)std::max<uint32_t>(1, parentVisits + node.virtualLoss));
+        uint32_t best = node.firstChild;
+        float bestScore = -1e30f;
+        for (uint32_t i = 0; i < node.childCount; ++i) {
+            const MCTSNode& child = nodes[node.firstChild + i];
+            int32_t virtualLoss = child.virtualLoss.load(std::memory_order_relaxed);
+            uint32_t visits = child.visits.load(std::memory_order_relaxed) + virtualLoss;
+            float q = visits ? (child.valueSum.load(std::memory_order_relaxed) - virtualLoss) / visits : firstPlay;
+            float score = q + config.cpuct * child.prior * sqrtParent / (1 + visits);
+            if (score > bestScore) {
+                bestScore = score;
+                best = node.firstChild + i;
+            }
+        }
+        return best;
+    }
+
+    // Terminal value for the side to move, checked in getGameResult's order; fills moves otherwise
+    static bool terminalValue(Position& position, MoveList& moves, float& value) {
+        value = 0.f;
+        if (position.insufficientMaterial()) return true;
+        position.generateLegal(moves);
+        if (moves.size == 0) {
+            if (position.inCheck(position.whiteToMove)) value = -1.f;
+            return true;
+        }
+        return position.movesSinceCapture >= 50 && position.movesSincePawnMovement >= 50;
+    }
+
+    float leafValue(Position& position, Xoshiro256& rng) const {
+        if (config.rolloutPlies == 0)
+            return std::tanh(Search::evaluate(position) / 400.f);
+        bool white = position.whiteToMove;
+        PlayoutResult playout = randomPlayout(position, rng, nullptr, config.rolloutPlies);
+        if (playout.outcome == GameOutcome::Ongoing) {
+            float material = std::tanh(Search::evaluate(position) / 400.f);
+            return position.whiteToMove == white ? material : -material;
+        }
+        if (playout.outcome == GameOutcome::Draw) return 0.f;
+        return (playout.outcome == GameOutcome::WhiteWins) == white ? 1.f : -1.f;
+    }
+
+    void searchThread() {
+        Xoshiro256 rng(splitMix64((uint64_t)std::hash<std::thread::id>{}(std::this_thread::get_id())));
+        std::vector<Leaf> batch(config.batchSize);
+        Matrix inputs(772, config.batchSize);
+        std::vector<uint32_t> path;
+
+        while (!outOfBudget()) {
+            size_t pending = 0;
+            size_t failedDescents = 0;
+
+            while (pending < config.batchSize && failedDescents <= config.batchSize && !outOfBudget()) {
+                Position position = rootPosition;
+                path.clear();
+                uint32_t index = 0;
+
+                while (true) {
+                    MCTSNode& node = nodes[index];
+                    path.push_back(index);
+                    node.virtualLoss.fetch_add(1, std::memory_order_relaxed);
+
+                    uint8_t state = node.state.load(std::memory_order_acquire);
+                    if (state == MCTSNode::Expanded) {
+                        index = selectChild(node);
+                        position.makeMove(nodes[index].move);
+                        continue;
+                    }
+                    if (state == MCTSNode::Terminal) {
+                        backup(path, node.terminalValue);
+                        break;
+                    }
+
+                    uint8_t expected = MCTSNode::Unexpanded;
+                    if (state == MCTSNode::Pending || !node.state.compare_exchange_strong(expected, MCTSNode::Pending)) {
+                        revertVirtualLoss(path);
+                        collisions++;
+                        failedDescents++;
+                        break;
+                    }
+
+                    Leaf& leaf = batch[pending];
+                    if (terminalValue(position, leaf.moves, node.terminalValue)) {
+                        node.state.store(MCTSNode::Terminal, std::memory_order_release);
+                        backup(path, node.terminalValue);
+                        break;
+                    }
+                    leaf.node = index;
+                    leaf.path = path;
+                    leaf.whiteToMove = position.whiteToMove;
+                    Search::encode(position, inputs, pending);
+                    leaf.value = leafValue(position, rng);
+                    pending++;
+                    break;
+                }
+            }
+
+            if (pending == 0) {
+                std::this_thread::yield();
+                continue;
+            }
+            evaluate(batch, inputs, pending);
+        }
+    }
+
+    void evaluate(std::vector<Leaf>& batch, const Matrix& inputs, size_t pending) {
+        Matrix outputs;
+        if (pending == inputs.cols) {
+            outputs = network.forwardBatch(inputs);
+        }
+        else {
+            Matrix partial(inputs.rows, pending);
+            for (size_t r = 0; r < inputs.rows; ++r)
+                for (size_t c = 0; c < pending; ++c)
+                    partial.data[r][c] = inputs.data[r][c];
+            outputs = network.forwardBatch(partial);
+        }
+        evaluations += pending;
+        batches++;
+
+        for (size_t i = 0; i < pending; ++i) {
+            Leaf& leaf = batch[i];
+            MCTSNode& node = nodes[leaf.node];
+            uint32_t first = used.fetch_add(leaf.moves.size);
+            if (first + leaf.moves.size > config.nodeCapacity) {
+                // Pool exhausted: score the leaf but leave it unexpanded, and wind the search down
+                full = true;
+                node.state.store(MCTSNode::Unexpanded, std::memory_order_release);
+                backup(leaf.path, leaf.value);
+                continue;
+            }
+
+            // The output layer is a softmax over all 128 squares, so a move's prior is the
+            // product of its from and to probabilities renormalized over the legal moves. That
+            // is very peaked for untrained networks, hence the uniform share.
+            float total = 0.f;
+            bool white = leaf.whiteToMove;
+            for (int m = 0; m < leaf.moves.size; ++m) {
+                const SquareMove& move = leaf.moves[m];
+                MCTSNode& child = nodes[first + m];
+                resetNode(child);
+                child.move = move;
+                child.prior = outputs.data[perspectiveSquare(move.from, white)][i] *
+                              outputs.data[64 + perspectiveSquare(move.to, white)][i];
+                total += child.prior;
+            }
+            float uniform = 1.f / leaf.moves.size;
+            for (int m = 0; m < leaf.moves.size; ++m) {
+                float policy = total > 0.f ? nodes[first + m].prior / total : uniform;
+                nodes[first + m].prior = (1.f - config.uniformPrior) * policy + config.uniformPrior * uniform;
+            }
+
+            node.firstChild = first;
+            node.childCount = (uint16_t)leaf.moves.size;
+            node.state.store(MCTSNode::Expanded, std::memory_order_release);
+            backup(leaf.path, leaf.value);
+        }
+    }
+};
@@ -0,0 +1,120 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <utility>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// Read-only memory mapping of a whole file. An empty or missing file maps to nullptr / 0,
+// check isOpen() before use.
+class MappedFile {
+public:
+    enum class Access { Sequential, Random };
+
+    MappedFile() = default;
+
+    explicit MappedFile(const std::string& path, Access access = Access::Sequential) {
+        open(path, access);
+    }
+
+    ~MappedFile() {
+        close();
+    }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    MappedFile(MappedFile&& other) noexcept {
+        *this = std::move(other);
+    }
+
+    MappedFile& operator=(MappedFile&& other) noexcept {
+        if (this != &other) {
+            close();
+            bytes = other.bytes;
+            length = other.length;
+#ifdef _WIN32
+            fileHandle = other.fileHandle;
+            mappingHandle = other.mappingHandle;
+            other.fileHandle = INVALID_HANDLE_VALUE;
+            other.mappingHandle = nullptr;
+#endif
+            other.bytes = nullptr;
+            other.length = 0;
+        }
+        return *this;
+    }
+
+    bool open(const std::string& path, Access access = Access::Sequential) {
+        close();
+#ifdef _WIN32
+        DWORD hint = access == Access::Sequential ? FILE_FLAG_SEQUENTIAL_SCAN : FILE_FLAG_RANDOM_ACCESS;
+        fileHandle = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, hint, nullptr);
+        if (fileHandle == INVALID_HANDLE_VALUE) return false;
+        LARGE_INTEGER size;
+        if (!GetFileSizeEx(fileHandle, &size) || size.QuadPart == 0) {
+            close();
+            return false;
+        }
+        mappingHandle = CreateFileMappingA(fileHandle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (!mappingHandle) {
+            close();
+            return false;
+        }
+        bytes = static_cast<const uint8_t*>(MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0));
+        length = bytes ? (size_t)size.QuadPart : 0;
+#else
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) return false;
+        struct stat info;
+        if (fstat(fd, &info) != 0 || info.st_size == 0) {
+            ::close(fd);
+            return false;
+        }
+        void* mapping = mmap(nullptr, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd);
+        if (mapping == MAP_FAILED) return false;
+        madvise(mapping, (size_t)info.st_size, access == Access::Sequential ? MADV_SEQUENTIAL : MADV_RANDOM);
+        bytes = static_cast<const uint8_t*>(mapping);
+        length = (size_t)info.st_size;
+#endif
+        return bytes != nullptr;
+    }
+
+    void close() {
+#ifdef _WIN32
+        if (bytes) UnmapViewOfFile(bytes);
+        if (mappingHandle) CloseHandle(mappingHandle);
+        if (fileHandle != INVALID_HANDLE_VALUE) CloseHandle(fileHandle);
+        mappingHandle = nullptr;
+        fileHandle = INVALID_HANDLE_VALUE;
+#else
+        if (bytes) munmap(const_cast<uint8_t*>(bytes), length);
+#endif
+        bytes = nullptr;
+        length = 0;
+    }
+
+    bool isOpen() const { return bytes != nullptr; }
+    const uint8_t* data() const { return bytes; }
+    size_t size() const { return length; }
+
+private:
+    const uint8_t* bytes = nullptr;
+    size_t length = 0;
+#ifdef _WIN32
+    HANDLE fileHandle = INVALID_HANDLE_VALUE;
+    HANDLE mappingHandle = nullptr;
+#endif
+};
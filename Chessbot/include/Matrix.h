@@ -27,6 +27,21 @@ struct Matrix {
         return vec;
     }
 
+    // Copy of a single column as a column vector
+    Matrix column(size_t j) const {
+        assert(j < cols);
+        Matrix result(rows, 1);
+        for (size_t i = 0; i < rows; ++i)
+            result.data[i][0] = data[i][j];
+        return result;
+    }
+
+    void setColumn(size_t j, const Matrix& vec) {
+        assert(j < cols && vec.rows == rows && vec.cols == 1);
+        for (size_t i = 0; i < rows; ++i)
+            data[i][j] = vec.data[i][0];
+    }
+
     // Element-wise addition
     Matrix operator+(const Matrix& other) const {
         assert(rows == other.rows && cols == other.cols);
@@ -38,16 +53,33 @@ struct Matrix {
     }
 
     // Matrix multiplication
+    // i-k-j order walks rows of both operands contiguously, which matters once other has
+    // more than one column (batched inputs). Each result element still sums k in order.
     Matrix operator*(const Matrix& other) const {
         assert(cols == other.rows);
         Matrix result(rows, other.cols);
-        for (size_t i = 0; i < rows; ++i)
-            for (size_t j = 0; j < other.cols; ++j)
-                for (size_t k = 0; k < cols; ++k)
-                    result.data[i][j] += data[i][k] * other.data[k][j];
+        for (size_t i = 0; i < rows; ++i) {
+            std::vector<float>& out = result.data[i];
+            for (size_t k = 0; k < cols; ++k) {
+                float a = data[i][k];
+                const std::vector<float>& row = other.data[k];
+                for (size_t j = 0; j < other.cols; ++j)
+                    out[j] += a * row[j];
+            }
+        }
         return result;
     }
 
+    // Adds a column vector to every column (bias over a batch)
+    void addToColumns(const Matrix& vec) {
+        assert(vec.rows == rows && vec.cols == 1);
+        for (size_t i = 0; i < rows; ++i) {
+            float b = vec.data[i][0];
+            for (size_t j = 0; j < cols; ++j)
+                data[i][j] += b;
+        }
+    }
+
     Matrix operator*(const float scalar) const {
         Matrix result(rows, cols);
         for (size_t i = 0; i < rows; ++i) {
@@ -100,6 +132,26 @@ struct Matrix {
         return result;
     }
 
+    // Apply softmax to each column independently
+    Matrix softmaxColumns() const {
+        Matrix result(rows, cols);
+        for (size_t j = 0; j < cols; ++j) {
+            float max_val = data[0][j];
+            for (size_t i = 1; i < rows; ++i)
+                if (data[i][j] > max_val)
+                    max_val = data[i][j];
+
+            float sum = 0.0;
+            for (size_t i = 0; i < rows; ++i) {
+                result.data[i][j] = std::exp(data[i][j] - max_val);
+                sum += result.data[i][j];
+            }
+            for (size_t i = 0; i < rows; ++i)
+                result.data[i][j] /= sum;
+        }
+        return result;
+    }
+
     // Derivative of softmax (assuming output is softmax vector and index is true class)
     Matrix softmaxDerivative(size_t trueIndex) const {
         assert(cols == 1);
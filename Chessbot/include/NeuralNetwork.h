@@ -1,6 +1,11 @@
 #pragma once
 #include <Matrix.h>
 #include <Activation.h>
+#include <Profiler.h>
+#include <SparseMatrix.h>
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
 #include <random>
 
 struct NeuralNetwork {
@@ -9,14 +14,22 @@ struct NeuralNetwork {
     std::vector<Activation> activations;
     size_t inputSize, outputSize;
     size_t layerCount;
+    // Process-wide unique id of the current weights, changed by anything that modifies them so
+    // cached outputs can be keyed on it. Copies share the id since they compute the same outputs.
+    uint64_t version = nextVersion();
+    // Kept weights of each layer after magnitude pruning, empty while the network is dense. A
+    // pruned weight is zero in weights and stays zero through backprop and bumpVersion.
+    std::vector<SparseMatrix> sparseWeights;
+
+    // Pruned layers at most this dense multiply through their CSR copy instead of the dense
+    // matrix. The CSR product measured faster at every density; the margin leaves room for
+    // machines where the dense one is faster near full density.
+    static constexpr double MaxSparseDensity = 0.9;
 
     // Sigmoid activations and final layer softmax
-    NeuralNetwork(size_t inputSize, size_t outputSize, const std::vector<size_t>& hiddenSizes)
+    NeuralNetwork(size_t inputSize, size_t outputSize, const std::vector<size_t>& hiddenSizes,
+                  unsigned int seed = std::random_device{}())
         : inputSize(inputSize), outputSize(outputSize) {
-        std::random_device rd;
-        std::mt19937 gen(rd());
-        std::uniform_real_distribution<> dist(-1.0, 1.0);
-
         std::vector<size_t> layerSizes = { inputSize };
         layerSizes.insert(layerSizes.end(), hiddenSizes.begin(), hiddenSizes.end());
         layerSizes.push_back(outputSize);
@@ -27,8 +40,20 @@ struct NeuralNetwork {
             weights.emplace_back(Matrix(layerSizes[i + 1], layerSizes[i]));
             biases.emplace_back(Matrix(layerSizes[i + 1], 1));
             activations.push_back(i == layerCount - 1 ? Activation::Softmax : Activation::Sigmoid);
+        }
 
-            // initialize weights and biases
+        initialize(seed);
+    }
+
+    // Re-draws weights and biases in place, reusing the existing allocations. The network is
+    // dense again afterwards.
+    void initialize(unsigned int seed) {
+        std::mt19937 gen(seed);
+        std::uniform_real_distribution<> dist(-1.0, 1.0);
+        sparseWeights.clear();
+        bumpVersion();
+
+        for (size_t i = 0; i < layerCount; ++i) {
             for (size_t r = 0; r < weights[i].rows; ++r) {
                 for (size_t c = 0; c < weights[i].cols; ++c)
                     weights[i].data[r][c] = dist(gen);
@@ -39,10 +64,12 @@ struct NeuralNetwork {
 
     // Forward pass
     Matrix forward(const Matrix& input, std::vector<Matrix>* layerOutputs = nullptr) const {
+        PROFILE_SCOPE(ProfileZone::Forward);
         Matrix a = input;
         if (layerOutputs) layerOutputs->clear();
         for (size_t i = 0; i < layerCount; ++i) {
-            Matrix z = (weights[i] * a) + biases[i];
+            PROFILE_SCOPE(forwardLayerZone(i));
+            Matrix z = multiplyWeights(i, a) + biases[i];
             if (activations[i] == Activation::Sigmoid)
                 a = z.sigmoid();
             else
@@ -52,8 +79,55 @@ struct NeuralNetwork {
         return a;
     }
 
+    // Forward pass over a batch: column j of inputs is one sample, column j of the result its output
+    Matrix forwardBatch(const Matrix& inputs) const {
+        PROFILE_SCOPE(ProfileZone::Forward);
+        PROFILE_COUNT(ProfileZone::Forward, inputs.cols);
+        Matrix a = inputs;
+        for (size_t i = 0; i < layerCount; ++i) {
+            PROFILE_SCOPE(forwardLayerZone(i));
+            Matrix z = multiplyWeights(i, a);
+            z.addToColumns(biases[i]);
+            if (activations[i] == Activation::Sigmoid)
+                a = z.sigmoid();
+            else
+                a = z.softmaxColumns();
+        }
+        return a;
+    }
+
+    // Activations entering the output layer (one sample per column), for callers that only need
+    // a few of its rows; see outputLogit
+    Matrix forwardHidden(const Matrix& inputs) const {
+        PROFILE_SCOPE(ProfileZone::Forward);
+        Matrix a = inputs;
+        for (size_t i = 0; i + 1 < layerCount; ++i) {
+            PROFILE_SCOPE(forwardLayerZone(i));
+            Matrix z = multiplyWeights(i, a);
+            z.addToColumns(biases[i]);
+            if (activations[i] == Activation::Sigmoid)
+                a = z.sigmoid();
+            else
+                a = z.softmaxColumns();
+        }
+        return a;
+    }
+
+    // One output row before the final activation, given one column of forwardHidden. The
+    // softmax is monotonic, so the largest logit among a set of rows is also the most probable.
+    float outputLogit(const std::vector<float>& hidden, size_t row) const {
+        if (usesSparse(layerCount - 1))
+            return sparseWeights[layerCount - 1].rowDot(row, hidden, biases[layerCount - 1].data[row][0]);
+        const std::vector<float>& w = weights[layerCount - 1].data[row];
+        float sum = biases[layerCount - 1].data[row][0];
+        for (size_t k = 0; k < w.size(); ++k)
+            sum += w[k] * hidden[k];
+        return sum;
+    }
+
     // Backpropagation (one sample)
     void backprop(const Matrix& input, const Matrix& target, double learningRate) {
+        PROFILE_SCOPE(ProfileZone::Backprop);
         std::vector<Matrix> activationsCache;
         Matrix output = forward(input, &activationsCache);
 
@@ -85,6 +159,78 @@ struct NeuralNetwork {
             for (size_t r = 0; r < biases[i].rows; ++r)
                 biases[i].data[r][0] -= learningRate * delta.data[r][0];
         }
+        bumpVersion(); // zeroes the pruned weights again, so they never take a step
+    }
+
+    // Magnitude pruning: zeroes the smallest weights of every layer, sparsity of each layer's
+    // weights in all, and keeps them at zero from then on. Sparsity only grows; a lower target than
+    // the current one changes nothing. A weight that is exactly zero counts as pruned.
+    void prune(double sparsity) {
+        if (sparseWeights.empty()) sparseWeights.resize(layerCount);
+        std::vector<float> magnitudes;
+        for (size_t i = 0; i < layerCount; ++i) {
+            Matrix& w = weights[i];
+            size_t target = (size_t)(std::min(std::max(sparsity, 0.0), 1.0) * w.rows * w.cols);
+            magnitudes.clear();
+            for (const std::vector<float>& row : w.data)
+                for (float value : row)
+                    magnitudes.push_back(std::abs(value));
+
+            if (target > 0) {
+                std::nth_element(magnitudes.begin(), magnitudes.begin() + (target - 1), magnitudes.end());
+                float threshold = magnitudes[target - 1];
+                // Everything below the threshold goes, then ties until the target is reached
+                size_t ties = target - (size_t)std::count_if(magnitudes.begin(), magnitudes.begin() + target,
+                                                             [&](float m) { return m < threshold; });
+                for (std::vector<float>& row : w.data) {
+                    for (float& value : row) {
+                        float m = std::abs(value);
+                        if (m < threshold || (m == threshold && ties > 0 && ties--)) value = 0.f;
+                    }
+                }
+            }
+            sparseWeights[i] = SparseMatrix(w);
+        }
+        bumpVersion();
+    }
+
+    // Share of all weights pruned
+    double sparsity() const {
+        if (sparseWeights.empty()) return 0.0;
+        size_t total = 0, kept = 0;
+        for (size_t i = 0; i < layerCount; ++i) {
+            total += weights[i].rows * weights[i].cols;
+            kept += sparseWeights[i].nonZeros();
+        }
+        return 1.0 - (double)kept / total;
+    }
+
+    bool usesSparse(size_t layer) const {
+        return !sparseWeights.empty() && sparseWeights[layer].density() <= MaxSparseDensity;
+    }
+
+    // Bytes of weights one forward pass reads, counting each layer in the form it is multiplied in
+    size_t inferenceWeightBytes() const {
+        size_t bytes = 0;
+        for (size_t i = 0; i < layerCount; ++i)
+            bytes += usesSparse(i) ? sparseWeights[i].memoryBytes() : weights[i].rows * weights[i].cols * sizeof(float);
+        return bytes;
+    }
+
+    // Call after writing weights or biases directly. Writes to pruned weights are undone.
+    void bumpVersion() {
+        version = nextVersion();
+        for (size_t i = 0; i < sparseWeights.size(); ++i)
+            sparseWeights[i].sync(weights[i]);
+    }
+
+    Matrix multiplyWeights(size_t layer, const Matrix& a) const {
+        return usesSparse(layer) ? sparseWeights[layer] * a : weights[layer] * a;
+    }
+
+    static uint64_t nextVersion() {
+        static std::atomic<uint64_t> counter{ 0 };
+        return ++counter;
     }
 
     // Transpose helper
@@ -0,0 +1,334 @@
+#pragma once
+#include <NeuralNetwork.h>
+#include <ChessBot.h>
+#include <random>
+#include <algorithm>
+
+// N networks with the same topology stored in a single arena.
+// Contiguous layout keeps each network's layer as one [row][col] block, so stacking the
+// blocks of the first layer scores one position with every network in a single GEMV.
+// Interleaved layout stores every weight for all networks side by side ([row][col][net]),
+// so each layer of the whole population is one loop nest that vectorizes across networks.
+struct Population {
+    std::vector<size_t> layerSizes;
+    size_t count;
+    bool interleaved;
+    std::vector<float> arena;
+    std::vector<size_t> weightOffsets;
+    std::vector<size_t> biasOffsets;
+
+    // Same initialization as NeuralNetwork: uniform [-1, 1], sigmoid hidden layers, softmax output.
+    // Network n is seeded with seed + n so the weights don't depend on the layout.
+    Population(size_t count, size_t inputSize, size_t outputSize, const std::vector<size_t>& hiddenSizes,
+               bool interleaved = true, unsigned int seed = std::random_device{}())
+        : count(count), interleaved(interleaved) {
+        layerSizes = { inputSize };
+        layerSizes.insert(layerSizes.end(), hiddenSizes.begin(), hiddenSizes.end());
+        layerSizes.push_back(outputSize);
+
+        size_t offset = 0;
+        for (size_t l = 0; l < layerCount(); ++l) {
+            weightOffsets.push_back(offset);
+            offset += count * rowsOf(l) * colsOf(l);
+            biasOffsets.push_back(offset);
+            offset += count * rowsOf(l);
+        }
+        arena.assign(offset, 0.f);
+
+        for (size_t n = 0; n < count; ++n) {
+            std::mt19937 gen(seed + (unsigned int)n);
+            std::uniform_real_distribution<> dist(-1.0, 1.0);
+            for (size_t l = 0; l < layerCount(); ++l) {
+                for (size_t r = 0; r < rowsOf(l); ++r) {
+                    for (size_t c = 0; c < colsOf(l); ++c)
+                        arena[weightIndex(l, n, r, c)] = dist(gen);
+                    arena[biasIndex(l, n, r)] = dist(gen);
+                }
+            }
+        }
+    }
+
+    size_t layerCount() const { return layerSizes.size() - 1; }
+    size_t rowsOf(size_t layer) const { return layerSizes[layer + 1]; }
+    size_t colsOf(size_t layer) const { return layerSizes[layer]; }
+    size_t inputSize() const { return layerSizes.front(); }
+    size_t outputSize() const { return layerSizes.back(); }
+
+    size_t weightIndex(size_t layer, size_t net, size_t r, size_t c) const {
+        if (interleaved)
+            return weightOffsets[layer] + (r * colsOf(layer) + c) * count + net;
+        return weightOffsets[layer] + (net * rowsOf(layer) + r) * colsOf(layer) + c;
+    }
+
+    size_t biasIndex(size_t layer, size_t net, size_t r) const {
+        if (interleaved)
+            return biasOffsets[layer] + r * count + net;
+        return biasOffsets[layer] + net * rowsOf(layer) + r;
+    }
+
+    // Scores one position (column vector) with every network. Column n of the result is network n's output.
+    Matrix forwardAll(const Matrix& input) const {
+        assert(input.rows == inputSize() && input.cols == 1);
+        std::vector<float> x(inputSize());
+        for (size_t i = 0; i < x.size(); ++i)
+            x[i] = input.data[i][0];
+        return run(x, true);
+    }
+
+    // Column n of inputs is fed to network n. Column n of the result is network n's output.
+    Matrix forwardEach(const Matrix& inputs) const {
+        assert(inputs.rows == inputSize() && inputs.cols == count);
+        std::vector<float> x(inputSize() * count);
+        for (size_t i = 0; i < inputs.rows; ++i)
+            for (size_t n = 0; n < count; ++n)
+                x[i * count + n] = inputs.data[i][n];
+        return run(x, false);
+    }
+
+    void clone(size_t src, size_t dst) {
+        if (src == dst) return;
+        for (size_t l = 0; l < layerCount(); ++l) {
+            for (size_t r = 0; r < rowsOf(l); ++r) {
+                copyRow(l, src, dst, r);
+            }
+        }
+    }
+
+    // Adds N(0, sigma) noise to roughly rate * paramCount parameters. Gaps between mutated
+    // parameters are drawn geometrically so the cost doesn't scale with an RNG call per weight.
+    // A rate of 1 or more mutates every parameter.
+    template<typename Rng>
+    void mutate(size_t net, double rate, double sigma, Rng& rng) {
+        if (!(rate > 0.0)) return;
+        bool everyParameter = rate >= 1.0;
+        // The distribution needs 0 < p < 1; with every parameter it is never drawn from
+        std::geometric_distribution<long long> gap(everyParameter ? 0.5 : rate);
+        std::normal_distribution<float> noise(0.f, (float)sigma);
+        long long skip = everyParameter ? 0 : gap(rng);
+        for (size_t l = 0; l < layerCount(); ++l) {
+            for (size_t r = 0; r < rowsOf(l); ++r) {
+                for (size_t c = 0; c <= colsOf(l); ++c) {
+                    if (skip-- > 0) continue;
+                    size_t index = c < colsOf(l) ? weightIndex(l, net, r, c) : biasIndex(l, net, r);
+                    arena[index] += noise(rng);
+                    skip = everyParameter ? 0 : gap(rng);
+                }
+            }
+        }
+    }
+
+    // Uniform crossover on whole neurons: each row (incoming weights + bias) comes from one parent
+    template<typename Rng>
+    void crossover(size_t parentA, size_t parentB, size_t child, Rng& rng) {
+        std::bernoulli_distribution coin(0.5);
+        for (size_t l = 0; l < layerCount(); ++l) {
+            for (size_t r = 0; r < rowsOf(l); ++r) {
+                copyRow(l, coin(rng) ? parentA : parentB, child, r);
+            }
+        }
+    }
+
+    NeuralNetwork toNetwork(size_t net) const {
+        std::vector<size_t> hiddenSizes(layerSizes.begin() + 1, layerSizes.end() - 1);
+        NeuralNetwork result(inputSize(), outputSize(), hiddenSizes);
+        for (size_t l = 0; l < layerCount(); ++l) {
+            for (size_t r = 0; r < rowsOf(l); ++r) {
+                for (size_t c = 0; c < colsOf(l); ++c)
+                    result.weights[l].data[r][c] = arena[weightIndex(l, net, r, c)];
+                result.biases[l].data[r][0] = arena[biasIndex(l, net, r)];
+            }
+        }
+        return result;
+    }
+
+    void setNetwork(size_t net, const NeuralNetwork& network) {
+        assert(network.layerCount == layerCount() && network.inputSize == inputSize() && network.outputSize == outputSize());
+        for (size_t l = 0; l < layerCount(); ++l) {
+            for (size_t r = 0; r < rowsOf(l); ++r) {
+                for (size_t c = 0; c < colsOf(l); ++c)
+                    arena[weightIndex(l, net, r, c)] = network.weights[l].data[r][c];
+                arena[biasIndex(l, net, r)] = network.biases[l].data[r][0];
+            }
+        }
+    }
+
+private:
+    void copyRow(size_t layer, size_t src, size_t dst, size_t r) {
+        if (src == dst) return;
+        if (interleaved) {
+            for (size_t c = 0; c < colsOf(layer); ++c)
+                arena[weightIndex(layer, dst, r, c)] = arena[weightIndex(layer, src, r, c)];
+        }
+        else {
+            auto from = arena.begin() + weightIndex(layer, src, r, 0);
+            std::copy(from, from + colsOf(layer), arena.begin() + weightIndex(layer, dst, r, 0));
+        }
+        arena[biasIndex(layer, dst, r)] = arena[biasIndex(layer, src, r)];
+    }
+
+    // Activations are kept as [row][net] throughout. When sharedInput is set, x is a single
+    // input vector used by every network in the first layer.
+    Matrix run(const std::vector<float>& x, bool sharedInput) const {
+        std::vector<float> a = x;
+        std::vector<float> z;
+        bool shared = sharedInput;
+
+        for (size_t l = 0; l < layerCount(); ++l) {
+            size_t rows = rowsOf(l), cols = colsOf(l);
+            z.assign(rows * count, 0.f);
+
+            if (interleaved) {
+                for (size_t r = 0; r < rows; ++r) {
+                    float* out = &z[r * count];
+                    const float* bias = &arena[biasIndex(l, 0, r)];
+                    for (size_t n = 0; n < count; ++n)
+                        out[n] = bias[n];
+                    for (size_t c = 0; c < cols; ++c) {
+                        const float* w = &arena[weightIndex(l, 0, r, c)];
+                        if (shared) {
+                            float xc = a[c];
+                            if (xc == 0.f) continue; // board encodings are mostly zeros
+                            for (size_t n = 0; n < count; ++n)
+                                out[n] += w[n] * xc;
+                        }
+                        else {
+                            const float* in = &a[c * count];
+                            for (size_t n = 0; n < count; ++n)
+                                out[n] += w[n] * in[n];
+                        }
+                    }
+                }
+            }
+            else {
+                // Shared input turns the stacked first-layer blocks into one (count * rows) x cols GEMV
+                std::vector<float> column(cols);
+                for (size_t n = 0; n < count; ++n) {
+                    const float* in = a.data();
+                    if (!shared) {
+                        for (size_t c = 0; c < cols; ++c)
+                            column[c] = a[c * count + n];
+                        in = column.data();
+                    }
+                    for (size_t r = 0; r < rows; ++r) {
+                        const float* w = &arena[weightIndex(l, n, r, 0)];
+                        float sum = arena[biasIndex(l, n, r)];
+                        for (size_t c = 0; c < cols; ++c)
+                            sum += w[c] * in[c];
+                        z[r * count + n] = sum;
+                    }
+                }
+            }
+
+            if (l + 1 < layerCount()) {
+                for (float& v : z)
+                    v = 1.f / (1.f + std::exp(-v));
+            }
+            else {
+                for (size_t n = 0; n < count; ++n) {
+                    float maxVal = z[n];
+                    for (size_t r = 1; r < rows; ++r)
+                        maxVal = std::max(maxVal, z[r * count + n]);
+                    float sum = 0.f;
+                    for (size_t r = 0; r < rows; ++r) {
+                        z[r * count + n] = std::exp(z[r * count + n] - maxVal);
+                        sum += z[r * count + n];
+                    }
+                    for (size_t r = 0; r < rows; ++r)
+                        z[r * count + n] /= sum;
+                }
+            }
+
+            a.swap(z);
+            shared = false;
+        }
+
+        Matrix result(outputSize(), count);
+        for (size_t r = 0; r < outputSize(); ++r)
+            for (size_t n = 0; n < count; ++n)
+                result.data[r][n] = a[r * count + n];
+        return result;
+    }
+};
+
+struct RoundRobinResult {
+    std::vector<float> scores; // 1 per win, 0.5 per draw
+    size_t games = 0;
+    size_t plies = 0;
+};
+
+// Every pair plays two games with colors swapped, and both games advance in lockstep. At any
+// ply each network is to move in exactly one of its games, so one forwardEach call per ply
+// evaluates the move of every network in the round.
+inline RoundRobinResult playRoundRobin(const Population& population) {
+    struct Game {
+        ChessBoard board;
+        size_t white, black;
+        bool whiteTurn = true;
+        bool finished = false;
+    };
+
+    RoundRobinResult result;
+    result.scores.assign(population.count, 0.f);
+
+    // Circle method, with a bye (index == count) when the population size is odd
+    std::vector<size_t> players(population.count);
+    for (size_t i = 0; i < players.size(); ++i) players[i] = i;
+    if (players.size() % 2 == 1) players.push_back(population.count);
+
+    for (size_t round = 0; round + 1 < players.size(); ++round) {
+        std::vector<Game> games;
+        for (size_t i = 0; i < players.size() / 2; ++i) {
+            size_t a = players[i], b = players[players.size() - 1 - i];
+            if (a == population.count || b == population.count) continue;
+            games.push_back({ ChessBoard(), a, b });
+            games.push_back({ ChessBoard(), b, a });
+        }
+
+        size_t active = games.size();
+        while (active > 0) {
+            Matrix inputs(population.inputSize(), population.count);
+            std::vector<Game*> mover(population.count, nullptr);
+
+            for (Game& game : games) {
+                if (game.finished) continue;
+
+                std::string outcome = game.board.getGameResult(game.whiteTurn);
+                if (outcome != "Game continues") {
+                    GameOutcome o = outcomeFromResult(outcome);
+                    if (o == GameOutcome::WhiteWins) result.scores[game.white] += 1.f;
+                    else if (o == GameOutcome::BlackWins) result.scores[game.black] += 1.f;
+                    else {
+                        result.scores[game.white] += 0.5f;
+                        result.scores[game.black] += 0.5f;
+                    }
+                    game.finished = true;
+                    result.games++;
+                    active--;
+                    continue;
+                }
+
+                size_t net = game.whiteTurn ? game.white : game.black;
+                assert(mover[net] == nullptr && "Network is to move in two games at once.");
+                mover[net] = &game;
+                inputs.setColumn(net, ChessBot::encodeBoard(game.board, game.whiteTurn));
+            }
+            if (active == 0) break;
+
+            Matrix outputs = population.forwardEach(inputs);
+
+            for (size_t net = 0; net < population.count; ++net) {
+                Game* game = mover[net];
+                if (!game) continue;
+
+                Move move = ChessBot::decideFromOutput(game->board, game->whiteTurn, outputs.column(net));
+                game->board.makeMove(move);
+                game->whiteTurn = !game->whiteTurn;
+                result.plies++;
+            }
+        }
+
+        std::rotate(players.begin() + 1, players.end() - 1, players.end());
+    }
+
+    return result;
+}
@@ -0,0 +1,475 @@
+#pragma once
+#include <ChessBoard.h>
+#include <Random.h>
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <sstream>
+#include <string>
+
+// Move between square indices (row * 8 + col), the same numbering as the network's outputs
+struct SquareMove {
+    uint8_t from = 0;
+    uint8_t to = 0;
+
+    Move toMove() const { return { { from / 8, from % 8 }, { to / 8, to % 8 } }; }
+    static SquareMove fromMove(const Move& move) {
+        return { (uint8_t)(move.from.row * 8 + move.from.col), (uint8_t)(move.to.row * 8 + move.to.col) };
+    }
+
+    bool operator==(const SquareMove& other) const { return from == other.from && to == other.to; }
+    bool operator!=(const SquareMove& other) const { return !(*this == other); }
+};
+
+// The network sees every position from the side to move: for black the ranks are mirrored and
+// the colors swapped, so one set of weights plays both sides. Both map in either direction.
+inline int perspectiveSquare(int square, bool whiteToMove) {
+    return whiteToMove ? square : square ^ 56;
+}
+
+inline int perspectivePiece(int piece, bool whiteToMove) {
+    if (whiteToMove || piece == (int)Piece::Empty) return piece;
+    return piece <= (int)Piece::WhiteKing ? piece + 6 : piece - 6;
+}
+
+// Fixed-capacity move list so move generation never allocates
+struct MoveList {
+    std::array<SquareMove, 256> moves;
+    int size = 0;
+
+    void push(uint8_t from, uint8_t to) { moves[size++] = { from, to }; }
+    void clear() { size = 0; }
+    bool contains(const SquareMove& move) const {
+        for (int i = 0; i < size; ++i)
+            if (moves[i] == move) return true;
+        return false;
+    }
+    SquareMove& operator[](int i) { return moves[i]; }
+    const SquareMove& operator[](int i) const { return moves[i]; }
+    const SquareMove* begin() const { return moves.data(); }
+    const SquareMove* end() const { return moves.data() + size; }
+};
+
+// Zobrist keys per piece and square, plus one for black to move. Empty squares hash to 0.
+struct ZobristKeys {
+    uint64_t pieceSquare[13][64];
+    uint64_t blackToMove;
+
+    ZobristKeys() {
+        uint64_t state = 0x43686573736A6F74ull;
+        for (int square = 0; square < 64; ++square)
+            pieceSquare[0][square] = 0;
+        for (int piece = 1; piece < 13; ++piece)
+            for (int square = 0; square < 64; ++square)
+                pieceSquare[piece][square] = splitMix64(state++);
+        blackToMove = splitMix64(state++);
+    }
+
+    static const ZobristKeys& get() {
+        static const ZobristKeys keys;
+        return keys;
+    }
+};
+
+// Mailbox position with make/unmake. Its move generation is written independently of
+// ChessBoard's so the two can check each other, but it follows the same rules: no castling,
+// no en passant, pawns always promote to a queen, and the 50-move rule needs both counters
+// at 50. Like ChessBoard::makeMove, a promotion counts as a non-pawn move for the counter.
+struct Position {
+    std::array<Piece, 64> squares;
+    bool whiteToMove = true;
+    int movesSincePawnMovement = 0;
+    int movesSinceCapture = 0;
+    std::array<int, 13> pieceCounts = {};
+    int kingSquare[2] = { -1, -1 }; // [1] white, [0] black
+    uint64_t hash = 0; // Zobrist key of the pieces and side to move; the move counters aren't included
+
+    struct Undo {
+        Piece moved;
+        Piece captured;
+        int movesSincePawnMovement;
+        int movesSinceCapture;
+        uint64_t hash;
+    };
+
+    static bool isWhite(Piece p) { return p >= Piece::WhitePawn && p <= Piece::WhiteKing; }
+    static bool isBlack(Piece p) { return p >= Piece::BlackPawn && p <= Piece::BlackKing; }
+    static bool isColor(Piece p, bool white) { return white ? isWhite(p) : isBlack(p); }
+
+    static Position startPosition() {
+        return fromChessBoard(ChessBoard(), true);
+    }
+
+    static Position fromChessBoard(const ChessBoard& board, bool whiteToMove) {
+        Position position;
+        for (int square = 0; square < 64; ++square)
+            position.squares[square] = board.board[square / 8][square % 8];
+        position.whiteToMove = whiteToMove;
+        position.movesSincePawnMovement = board.getMovesSincePawnMovement();
+        position.movesSinceCapture = board.getMovesSinceCapture();
+        position.recount();
+        return position;
+    }
+
+    // Parses the board, side to move and halfmove clock; castling and en passant fields are
+    // ignored since this variant has neither. The halfmove clock becomes both move counters,
+    // which is what toFEN wrote for any position where they were equal. False on malformed input.
+    static bool fromFEN(const std::string& fen, Position& position) {
+        std::istringstream in(fen);
+        std::string placement, side, castling, enPassant;
+        int halfmoves = 0;
+        if (!(in >> placement >> side)) return false;
+        in >> castling >> enPassant >> halfmoves;
+
+        const std::string symbols = ".PRNBQKprnbqk";
+        Position parsed;
+        parsed.squares.fill(Piece::Empty);
+        int row = 7, col = 0;
+        for (char c : placement) {
+            if (c == '/') {
+                if (col != 8 || row == 0) return false;
+                row--;
+                col = 0;
+            }
+            else if (c >= '1' && c <= '8') {
+                col += c - '0';
+                if (col > 8) return false;
+            }
+            else {
+                size_t piece = symbols.find(c);
+                if (piece == std::string::npos || piece == 0 || col >= 8) return false;
+                parsed.squares[row * 8 + col++] = (Piece)piece;
+            }
+        }
+        if (row != 0 || col != 8 || (side != "w" && side != "b")) return false;
+
+        parsed.whiteToMove = side == "w";
+        parsed.movesSincePawnMovement = parsed.movesSinceCapture = std::max(halfmoves, 0);
+        parsed.recount();
+        if (parsed.pieceCounts[(int)Piece::WhiteKing] != 1 || parsed.pieceCounts[(int)Piece::BlackKing] != 1) return false;
+        position = parsed;
+        return true;
+    }
+
+    ChessBoard toChessBoard() const {
+        ChessBoard board;
+        for (int square = 0; square < 64; ++square)
+            board.board[square / 8][square % 8] = squares[square];
+        board.setMoveCounters(movesSincePawnMovement, movesSinceCapture);
+        return board;
+    }
+
+    // Rebuilds piece counts, king squares and hash after squares or whiteToMove were set directly
+    void recount() {
+        const ZobristKeys& keys = ZobristKeys::get();
+        pieceCounts.fill(0);
+        kingSquare[0] = kingSquare[1] = -1;
+        hash = whiteToMove ? 0 : keys.blackToMove;
+        for (int square = 0; square < 64; ++square) {
+            pieceCounts[(int)squares[square]]++;
+            hash ^= keys.pieceSquare[(int)squares[square]][square];
+            if (squares[square] == Piece::WhiteKing) kingSquare[1] = square;
+            if (squares[square] == Piece::BlackKing) kingSquare[0] = square;
+        }
+    }
+
+    bool isAttacked(int square, bool byWhite) const {
+        int r = square / 8, c = square % 8;
+
+        // A pawn attacks diagonally forward, so look one row back from the target
+        int pawnRow = byWhite ? r - 1 : r + 1;
+        Piece pawn = byWhite ? Piece::WhitePawn : Piece::BlackPawn;
+        if (pawnRow >= 0 && pawnRow < 8) {
+            if (c > 0 && squares[pawnRow * 8 + c - 1] == pawn) return true;
+            if (c < 7 && squares[pawnRow * 8 + c + 1] == pawn) return true;
+        }
+
+        static const int knightDr[8] = { -2, -1, 1, 2, 2, 1, -1, -2 };
+        static const int knightDc[8] = { 1, 2, 2, 1, -1, -2, -2, -1 };
+        Piece knight = byWhite ? Piece::WhiteKnight : Piece::BlackKnight;
+        for (int i = 0; i < 8; ++i) {
+            int nr = r + knightDr[i], nc = c + knightDc[i];
+            if (nr >= 0 && nr < 8 && nc >= 0 && nc < 8 && squares[nr * 8 + nc] == knight) return true;
+        }
+
+        Piece king = byWhite ? Piece::WhiteKing : Piece::BlackKing;
+        for (int dr = -1; dr <= 1; ++dr) {
+            for (int dc = -1; dc <= 1; ++dc) {
+                int nr = r + dr, nc = c + dc;
+                if ((dr || dc) && nr >= 0 && nr < 8 && nc >= 0 && nc < 8 && squares[nr * 8 + nc] == king) return true;
+            }
+        }
+
+        Piece rook = byWhite ? Piece::WhiteRook : Piece::BlackRook;
+        Piece bishop = byWhite ? Piece::WhiteBishop : Piece::BlackBishop;
+        Piece queen = byWhite ? Piece::WhiteQueen : Piece::BlackQueen;
+        static const int rayDr[8] = { 1, -1, 0, 0, 1, 1, -1, -1 };
+        static const int rayDc[8] = { 0, 0, 1, -1, 1, -1, 1, -1 };
+        for (int d = 0; d < 8; ++d) {
+            Piece slider = d < 4 ? rook : bishop;
+            for (int nr = r + rayDr[d], nc = c + rayDc[d]; nr >= 0 && nr < 8 && nc >= 0 && nc < 8; nr += rayDr[d], nc += rayDc[d]) {
+                Piece p = squares[nr * 8 + nc];
+                if (p == Piece::Empty) continue;
+                if (p == slider || p == queen) return true;
+                break;
+            }
+        }
+        return false;
+    }
+
+    // A missing king counts as in check, as in ChessBoard::isInCheck
+    bool inCheck(bool white) const {
+        PROFILE_SCOPE(ProfileZone::IsInCheck);
+        int king = kingSquare[white ? 1 : 0];
+        return king < 0 || isAttacked(king, !white);
+    }
+
+    // Moves for the side to move that may leave its own king in check
+    void generatePseudoLegal(MoveList& list, bool capturesOnly = false) const {
+        PROFILE_SCOPE(ProfileZone::MoveGen);
+        list.clear();
+        bool white = whiteToMove;
+        for (int from = 0; from < 64; ++from) {
+            Piece p = squares[from];
+            if (!isColor(p, white)) continue;
+            int r = from / 8, c = from % 8;
+
+            switch (p) {
+            case Piece::WhitePawn:
+            case Piece::BlackPawn: {
+                int dir = white ? 1 : -1;
+                int startRow = white ? 1 : 6;
+                int nr = r + dir;
+                if (nr < 0 || nr > 7) break;
+                for (int dc = -1; dc <= 1; dc += 2) {
+                    int nc = c + dc;
+                    if (nc >= 0 && nc < 8 && isColor(squares[nr * 8 + nc], !white)) list.push(from, nr * 8 + nc);
+                }
+                if (capturesOnly) break;
+                if (squares[nr * 8 + c] == Piece::Empty) {
+                    list.push(from, nr * 8 + c);
+                    if (r == startRow && squares[(nr + dir) * 8 + c] == Piece::Empty) list.push(from, (nr + dir) * 8 + c);
+                }
+                break;
+            }
+            case Piece::WhiteKnight:
+            case Piece::BlackKnight: {
+                static const int dr[8] = { -2, -1, 1, 2, 2, 1, -1, -2 };
+                static const int dc[8] = { 1, 2, 2, 1, -1, -2, -2, -1 };
+                for (int i = 0; i < 8; ++i) {
+                    int nr = r + dr[i], nc = c + dc[i];
+                    if (nr < 0 || nr > 7 || nc < 0 || nc > 7) continue;
+                    addIfTarget(list, from, nr * 8 + nc, white, capturesOnly);
+                }
+                break;
+            }
+            case Piece::WhiteKing:
+            case Piece::BlackKing: {
+                for (int dr = -1; dr <= 1; ++dr) {
+                    for (int dc = -1; dc <= 1; ++dc) {
+                        int nr = r + dr, nc = c + dc;
+                        if ((!dr && !dc) || nr < 0 || nr > 7 || nc < 0 || nc > 7) continue;
+                        addIfTarget(list, from, nr * 8 + nc, white, capturesOnly);
+                    }
+                }
+                break;
+            }
+            default: {
+                static const int dr[8] = { 1, -1, 0, 0, 1, 1, -1, -1 };
+                static const int dc[8] = { 0, 0, 1, -1, 1, -1, 1, -1 };
+                int first = 0, last = 8;
+                if (p == Piece::WhiteRook || p == Piece::BlackRook) last = 4;
+                if (p == Piece::WhiteBishop || p == Piece::BlackBishop) first = 4;
+                for (int d = first; d < last; ++d) {
+                    for (int nr = r + dr[d], nc = c + dc[d]; nr >= 0 && nr < 8 && nc >= 0 && nc < 8; nr += dr[d], nc += dc[d]) {
+                        Piece target = squares[nr * 8 + nc];
+                        if (target == Piece::Empty) {
+                            if (!capturesOnly) list.push(from, nr * 8 + nc);
+                            continue;
+                        }
+                        if (isColor(target, !white)) list.push(from, nr * 8 + nc);
+                        break;
+                    }
+                }
+                break;
+            }
+            }
+        }
+    }
+
+    void generateLegal(MoveList& list, bool capturesOnly = false) {
+        MoveList pseudo;
+        generatePseudoLegal(pseudo, capturesOnly);
+        list.clear();
+        bool white = whiteToMove;
+        for (const SquareMove& move : pseudo) {
+            Undo undo = makeMove(move);
+            if (!inCheck(white)) list.moves[list.size++] = move;
+            unmakeMove(move, undo);
+        }
+    }
+
+    bool hasLegalMove() {
+        MoveList pseudo;
+        generatePseudoLegal(pseudo);
+        bool white = whiteToMove;
+        for (const SquareMove& move : pseudo) {
+            Undo undo = makeMove(move);
+            bool legal = !inCheck(white);
+            unmakeMove(move, undo);
+            if (legal) return true;
+        }
+        return false;
+    }
+
+    Undo makeMove(const SquareMove& move) {
+        const ZobristKeys& keys = ZobristKeys::get();
+        Undo undo = { squares[move.from], squares[move.to], movesSincePawnMovement, movesSinceCapture, hash };
+        Piece moving = undo.moved;
+        if (moving == Piece::WhitePawn && move.to / 8 == 7) moving = Piece::WhiteQueen;
+        else if (moving == Piece::BlackPawn && move.to / 8 == 0) moving = Piece::BlackQueen;
+
+        movesSinceCapture = undo.captured != Piece::Empty ? 0 : movesSinceCapture + 1;
+        movesSincePawnMovement = (moving == Piece::WhitePawn || moving == Piece::BlackPawn) ? 0 : movesSincePawnMovement + 1;
+
+        if (undo.captured != Piece::Empty) {
+            pieceCounts[(int)undo.captured]--;
+            pieceCounts[(int)Piece::Empty]++;
+            if (undo.captured == Piece::WhiteKing) kingSquare[1] = -1;
+            if (undo.captured == Piece::BlackKing) kingSquare[0] = -1;
+        }
+        if (moving != undo.moved) {
+            pieceCounts[(int)undo.moved]--;
+            pieceCounts[(int)moving]++;
+        }
+        if (moving == Piece::WhiteKing) kingSquare[1] = move.to;
+        if (moving == Piece::BlackKing) kingSquare[0] = move.to;
+
+        hash ^= keys.pieceSquare[(int)undo.moved][move.from] ^ keys.pieceSquare[(int)undo.captured][move.to] ^
+                keys.pieceSquare[(int)moving][move.to] ^ keys.blackToMove;
+
+        squares[move.to] = moving;
+        squares[move.from] = Piece::Empty;
+        whiteToMove = !whiteToMove;
+        return undo;
+    }
+
+    void unmakeMove(const SquareMove& move, const Undo& undo) {
+        Piece moving = squares[move.to];
+        if (moving != undo.moved) {
+            pieceCounts[(int)moving]--;
+            pieceCounts[(int)undo.moved]++;
+        }
+        if (undo.captured != Piece::Empty) {
+            pieceCounts[(int)undo.captured]++;
+            pieceCounts[(int)Piece::Empty]--;
+            if (undo.captured == Piece::WhiteKing) kingSquare[1] = move.to;
+            if (undo.captured == Piece::BlackKing) kingSquare[0] = move.to;
+        }
+        if (undo.moved == Piece::WhiteKing) kingSquare[1] = move.from;
+        if (undo.moved == Piece::BlackKing) kingSquare[0] = move.from;
+
+        squares[move.from] = undo.moved;
+        squares[move.to] = undo.captured;
+        movesSincePawnMovement = undo.movesSincePawnMovement;
+        movesSinceCapture = undo.movesSinceCapture;
+        hash = undo.hash;
+        whiteToMove = !whiteToMove;
+    }
+
+    int pieceTotal() const {
+        return 64 - pieceCounts[(int)Piece::Empty];
+    }
+
+    bool insufficientMaterial() const {
+        int total = pieceTotal();
+        if (total == 2) return true;
+        if (total == 3) {
+            return pieceCounts[(int)Piece::WhiteBishop] + pieceCounts[(int)Piece::BlackBishop] +
+                   pieceCounts[(int)Piece::WhiteKnight] + pieceCounts[(int)Piece::BlackKnight] > 0;
+        }
+        return false;
+    }
+
+    // The installed adjudicator's result (see Tablebase::install), or nullptr
+    const char* adjudicate() const {
+        const Adjudicator& hook = adjudicator();
+        if (!hook.adjudicate || pieceTotal() > hook.maxPieces) return nullptr;
+        return hook.adjudicate(squares.data(), whiteToMove, std::min(movesSinceCapture, movesSincePawnMovement));
+    }
+
+    // Same checks in the same order as ChessBoard::getGameResult
+    std::string gameResult() {
+        if (insufficientMaterial()) return "Draw (Insufficient Material)";
+        if (!hasLegalMove()) {
+            if (inCheck(whiteToMove)) return whiteToMove ? "Black wins (Checkmate)" : "White wins (Checkmate)";
+            return "Draw (Stalemate)";
+        }
+        if (movesSinceCapture >= 50 && movesSincePawnMovement >= 50) return "Draw (50-move rule)";
+        if (const char* adjudicated = adjudicate()) return adjudicated;
+        return "Game continues";
+    }
+
+    // Coordinate notation as ChessBoard::toSAN writes it, with a trailing 'q' on promotions
+    std::string toLAN(const SquareMove& move) const {
+        std::string lan = { (char)('a' + move.from % 8), (char)('1' + move.from / 8), (char)('a' + move.to % 8), (char)('1' + move.to / 8) };
+        Piece moving = squares[move.from];
+        if ((moving == Piece::WhitePawn && move.to / 8 == 7) || (moving == Piece::BlackPawn && move.to / 8 == 0))
+            lan += 'q';
+        return lan;
+    }
+
+    // Reads a move such as e2e4 or e7e8q, as toLAN writes it, if it is legal here. Promotions
+    // are always to a queen: a fifth letter other than q, or one on a move that doesn't promote,
+    // is rejected, and leaving it off is accepted.
+    bool parseLAN(const std::string& lan, SquareMove& move) {
+        if (lan.size() < 4 || lan.size() > 5) return false;
+        int squares[2];
+        for (int i = 0; i < 2; ++i) {
+            char file = lan[i * 2], rank = lan[i * 2 + 1];
+            if (file < 'a' || file > 'h' || rank < '1' || rank > '8') return false;
+            squares[i] = (rank - '1') * 8 + (file - 'a');
+        }
+        move = { (uint8_t)squares[0], (uint8_t)squares[1] };
+        if (lan.size() == 5 && (lan[4] != 'q' || toLAN(move).size() != 5)) return false;
+        MoveList legal;
+        generateLegal(legal);
+        return legal.contains(move);
+    }
+
+    // FEN of the position. Castling and en passant fields are always "-" in this variant, and
+    // the halfmove clock is the pawn counter.
+    std::string toFEN() const {
+        const char symbols[] = ".PRNBQKprnbqk";
+        std::string fen;
+        for (int r = 7; r >= 0; --r) {
+            int empty = 0;
+            for (int c = 0; c < 8; ++c) {
+                Piece p = squares[r * 8 + c];
+                if (p == Piece::Empty) {
+                    empty++;
+                    continue;
+                }
+                if (empty) fen += (char)('0' + empty);
+                empty = 0;
+                fen += symbols[(int)p];
+            }
+            if (empty) fen += (char)('0' + empty);
+            if (r > 0) fen += '/';
+        }
+        fen += whiteToMove ? " w - - " : " b - - ";
+        fen += std::to_string(movesSincePawnMovement) + " 1";
+        return fen;
+    }
+
+private:
+    void addIfTarget(MoveList& list, int from, int to, bool white, bool capturesOnly) const {
+        Piece target = squares[to];
+        if (target == Piece::Empty) {
+            if (!capturesOnly) list.push(from, to);
+        }
+        else if (isColor(target, !white)) {
+            list.push(from, to);
+        }
+    }
+};
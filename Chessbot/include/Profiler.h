@@ -0,0 +1,290 @@
+#pragma once
+// Hot-path instrumentation. Define CHESSBOT_PROFILE (e.g. /D CHESSBOT_PROFILE or -DCHESSBOT_PROFILE)
+// to enable it; otherwise PROFILE_SCOPE and PROFILE_COUNT compile to nothing.
+//
+//   PROFILE_SCOPE(ProfileZone::MoveGen);       times the enclosing scope
+//   PROFILE_COUNT(ProfileZone::FileIO, bytes);  adds to the zone's item count
+//
+// Each thread accumulates into its own counters, registered once under a mutex and then
+// written without locks or atomic read-modify-writes. Reports can be written at any time
+// (Profiler::writeJSON / writeCSV, or periodically with startPeriodicReport); Chrome trace
+// events are kept per thread when enableTrace() was called and written by writeChromeTrace.
+#include <cstddef>
+#include <cstdint>
+
+enum class ProfileZone : uint8_t {
+    MoveGen,
+    IsInCheck,
+    EncodeBoard,
+    Forward,
+    ForwardLayer0, ForwardLayer1, ForwardLayer2, ForwardLayer3,
+    ForwardLayer4, ForwardLayer5, ForwardLayer6, ForwardLayer7,
+    LegalLogits,
+    Backprop,
+    FileIO,
+    Count
+};
+
+inline ProfileZone forwardLayerZone(size_t layer) {
+    return (ProfileZone)((size_t)ProfileZone::ForwardLayer0 + (layer < 8 ? layer : 7));
+}
+
+inline const char* profileZoneName(ProfileZone zone) {
+    static const char* names[] = {
+        "movegen", "isInCheck", "encodeBoard", "forward",
+        "forwardLayer0", "forwardLayer1", "forwardLayer2", "forwardLayer3",
+        "forwardLayer4", "forwardLayer5", "forwardLayer6", "forwardLayer7",
+        "legalLogits", "backprop", "fileIO"
+    };
+    return names[(size_t)zone];
+}
+
+#ifdef CHESSBOT_PROFILE
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+class Profiler {
+public:
+    static constexpr size_t ZoneCount = (size_t)ProfileZone::Count;
+
+    struct TraceEvent {
+        ProfileZone zone;
+        uint64_t start;
+        uint64_t end;
+    };
+
+    // Only the owning thread writes; relaxed load + store keeps concurrent reports race-free
+    // without the cost of an atomic increment
+    struct ThreadProfile {
+        size_t index = 0;
+        std::atomic<uint64_t> calls[ZoneCount] = {};
+        std::atomic<uint64_t> ticks[ZoneCount] = {};
+        std::atomic<uint64_t> items[ZoneCount] = {};
+        std::vector<TraceEvent> events;
+        std::atomic<size_t> eventCount{ 0 };
+
+        static void add(std::atomic<uint64_t>& counter, uint64_t amount) {
+            counter.store(counter.load(std::memory_order_relaxed) + amount, std::memory_order_relaxed);
+        }
+    };
+
+    static uint64_t now() {
+#if defined(_MSC_VER) || defined(__x86_64__) || defined(__i386__)
+        return __rdtsc();
+#else
+        return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+    }
+
+    static ThreadProfile& thread() {
+        thread_local ThreadProfile* profile = registerThread();
+        return *profile;
+    }
+
+    static void record(ProfileZone zone, uint64_t start, uint64_t end) {
+        ThreadProfile& profile = thread();
+        ThreadProfile::add(profile.calls[(size_t)zone], 1);
+        ThreadProfile::add(profile.ticks[(size_t)zone], end - start);
+
+        size_t count = profile.eventCount.load(std::memory_order_relaxed);
+        if (count < profile.events.size()) {
+            profile.events[count] = { zone, start, end };
+            profile.eventCount.store(count + 1, std::memory_order_release);
+        }
+    }
+
+    static void count(ProfileZone zone, uint64_t items) {
+        ThreadProfile::add(thread().items[(size_t)zone], items);
+    }
+
+    // Keeps the first maxEventsPerThread scopes of every thread registered after this call
+    static void enableTrace(size_t maxEventsPerThread) {
+        std::lock_guard<std::mutex> lock(state().mutex);
+        state().traceCapacity = maxEventsPerThread;
+    }
+
+    static double ticksPerSecond() {
+        const State& s = state();
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - s.startTime).count();
+        uint64_t ticks = now() - s.startTicks;
+        return seconds > 0.0 && ticks > 0 ? ticks / seconds : 1e9;
+    }
+
+    static void writeJSON(std::ostream& out) {
+        std::lock_guard<std::mutex> lock(state().mutex);
+        double tickRate = ticksPerSecond();
+        const State& s = state();
+        out << "{\"elapsedSeconds\":" << std::chrono::duration<double>(std::chrono::steady_clock::now() - s.startTime).count()
+            << ",\"threads\":" << s.threads.size() << ",\"zones\":[";
+        for (size_t zone = 0; zone < ZoneCount; ++zone) {
+            uint64_t calls = 0, ticks = 0, items = 0;
+            for (const auto& profile : s.threads) {
+                calls += profile->calls[zone].load(std::memory_order_relaxed);
+                ticks += profile->ticks[zone].load(std::memory_order_relaxed);
+                items += profile->items[zone].load(std::memory_order_relaxed);
+            }
+            out << (zone ? "," : "") << "{\"zone\":\"" << profileZoneName((ProfileZone)zone) << "\",\"calls\":" << calls
+                << ",\"seconds\":" << ticks / tickRate << ",\"averageNs\":" << (calls ? ticks / tickRate / calls * 1e9 : 0.0)
+                << ",\"items\":" << items << ",\"perThreadSeconds\":[";
+            for (size_t t = 0; t < s.threads.size(); ++t)
+                out << (t ? "," : "") << s.threads[t]->ticks[zone].load(std::memory_order_relaxed) / tickRate;
+            out << "]}";
+        }
+        out << "]}\n";
+    }
+
+    static void writeCSV(std::ostream& out) {
+        std::lock_guard<std::mutex> lock(state().mutex);
+        double tickRate = ticksPerSecond();
+        out << "thread,zone,calls,seconds,items\n";
+        for (const auto& profile : state().threads) {
+            for (size_t zone = 0; zone < ZoneCount; ++zone) {
+                uint64_t calls = profile->calls[zone].load(std::memory_order_relaxed);
+                if (!calls && !profile->items[zone].load(std::memory_order_relaxed)) continue;
+                out << profile->index << "," << profileZoneName((ProfileZone)zone) << "," << calls << ","
+                    << profile->ticks[zone].load(std::memory_order_relaxed) / tickRate << ","
+                    << profile->items[zone].load(std::memory_order_relaxed) << "\n";
+            }
+        }
+    }
+
+    // Chrome / Perfetto trace-event JSON ("X" complete events, microseconds)
+    static bool writeChromeTrace(const std::string& path) {
+        std::ofstream out(path);
+        if (!out.is_open()) {
+            std::cerr << "Error: Could not open the file '" << path << "'" << std::endl;
+            return false;
+        }
+        std::lock_guard<std::mutex> lock(state().mutex);
+        double microsPerTick = 1e6 / ticksPerSecond();
+        uint64_t origin = state().startTicks;
+        bool first = true;
+        out << "{\"traceEvents\":[";
+        for (const auto& profile : state().threads) {
+            size_t count = profile->eventCount.load(std::memory_order_acquire);
+            for (size_t i = 0; i < count; ++i) {
+                const TraceEvent& event = profile->events[i];
+                out << (first ? "" : ",\n") << "{\"name\":\"" << profileZoneName(event.zone) << "\",\"ph\":\"X\",\"pid\":1,\"tid\":"
+                    << profile->index << ",\"ts\":" << (event.start - origin) * microsPerTick
+                    << ",\"dur\":" << (event.end - event.start) * microsPerTick << "}";
+                first = false;
+            }
+        }
+        out << "]}\n";
+        return true;
+    }
+
+    // Rewrites path every intervalSeconds until stopPeriodicReport; .csv paths get CSV, others JSON
+    static void startPeriodicReport(const std::string& path, double intervalSeconds) {
+        stopPeriodicReport();
+        State& s = state();
+        s.reporting = true;
+        s.reporter = std::thread([path, intervalSeconds] {
+            State& s = state();
+            std::unique_lock<std::mutex> lock(s.reporterMutex);
+            while (s.reporting) {
+                s.reporterWake.wait_for(lock, std::chrono::duration<double>(intervalSeconds), [&s] { return !s.reporting; });
+                writeReport(path);
+            }
+        });
+    }
+
+    static void stopPeriodicReport() {
+        State& s = state();
+        {
+            std::lock_guard<std::mutex> lock(s.reporterMutex);
+            s.reporting = false;
+        }
+        s.reporterWake.notify_all();
+        if (s.reporter.joinable()) s.reporter.join();
+    }
+
+    static bool writeReport(const std::string& path) {
+        std::ofstream out(path);
+        if (!out.is_open()) return false;
+        bool csv = path.size() >= 4 && path.compare(path.size() - 4, 4, ".csv") == 0;
+        if (csv) writeCSV(out);
+        else writeJSON(out);
+        return true;
+    }
+
+private:
+    struct State {
+        std::mutex mutex;
+        std::vector<std::unique_ptr<ThreadProfile>> threads;
+        size_t traceCapacity = 0;
+        std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+        uint64_t startTicks = now();
+
+        std::thread reporter;
+        std::mutex reporterMutex;
+        std::condition_variable reporterWake;
+        bool reporting = false;
+
+        ~State() {
+            {
+                std::lock_guard<std::mutex> lock(reporterMutex);
+                reporting = false;
+            }
+            reporterWake.notify_all();
+            if (reporter.joinable()) reporter.join();
+        }
+    };
+
+    static State& state() {
+        static State s;
+        return s;
+    }
+
+    // Profiles are owned by the registry so they outlive short-lived pool threads
+    static ThreadProfile* registerThread() {
+        State& s = state();
+        std::lock_guard<std::mutex> lock(s.mutex);
+        s.threads.emplace_back(new ThreadProfile());
+        ThreadProfile* profile = s.threads.back().get();
+        profile->index = s.threads.size() - 1;
+        profile->events.resize(s.traceCapacity);
+        return profile;
+    }
+};
+
+class ProfileScope {
+public:
+    explicit ProfileScope(ProfileZone zone) : zone(zone), start(Profiler::now()) {}
+    ~ProfileScope() { Profiler::record(zone, start, Profiler::now()); }
+
+    ProfileScope(const ProfileScope&) = delete;
+    ProfileScope& operator=(const ProfileScope&) = delete;
+
+private:
+    ProfileZone zone;
+    uint64_t start;
+};
+
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+#define PROFILE_SCOPE(zone) ProfileScope PROFILE_CONCAT(profileScope, __LINE__)(zone)
+#define PROFILE_COUNT(zone, items) Profiler::count(zone, (uint64_t)(items))
+
+#else
+
+#define PROFILE_SCOPE(zone) ((void)0)
+#define PROFILE_COUNT(zone, items) ((void)0)
+
+#endif
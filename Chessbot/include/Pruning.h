@@ -0,0 +1,32 @@
+#pragma once
+#include <NeuralNetwork.h>
+#include <algorithm>
+#include <cstddef>
+
+// Gradual magnitude pruning: every frequency steps between startStep and endStep the network
+// is pruned to a sparsity rising from initialSparsity to finalSparsity along a cubic, so most
+// weights go early, while there are many small ones, and training has time to recover from
+// the last few.
+struct PruningSchedule {
+    bool enabled = false;
+    double initialSparsity = 0.0;
+    double finalSparsity = 0.9;
+    size_t startStep = 0;
+    size_t endStep = 10000;
+    size_t frequency = 100;
+
+    double sparsityAt(size_t step) const {
+        if (step < startStep) return 0.0;
+        if (step >= endStep) return finalSparsity;
+        double remaining = 1.0 - (double)(step - startStep) / (endStep - startStep);
+        return finalSparsity + (initialSparsity - finalSparsity) * remaining * remaining * remaining;
+    }
+
+    // Call after every training step; prunes when step is a pruning step and returns whether it did
+    bool update(NeuralNetwork& network, size_t step) const {
+        if (!enabled || step < startStep || step > endStep) return false;
+        if ((step - startStep) % std::max<size_t>(frequency, 1) != 0 && step != endStep) return false;
+        network.prune(sparsityAt(step));
+        return true;
+    }
+};
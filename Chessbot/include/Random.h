@@ -0,0 +1,58 @@
+#pragma once
+#include <cstdint>
+#include <limits>
+
+inline uint64_t splitMix64(uint64_t x) {
+    x += 0x9E3779B97F4A7C15ull;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+    return x ^ (x >> 31);
+}
+
+// xoshiro256** (Blackman & Vigna). Much smaller and faster than std::mt19937 and usable with
+// the standard distributions, but below() is the cheap way to pick an index.
+class Xoshiro256 {
+public:
+    using result_type = uint64_t;
+
+    explicit Xoshiro256(uint64_t seed = 0) { this->seed(seed); }
+
+    void seed(uint64_t seed) {
+        for (uint64_t& word : state) {
+            seed += 0x9E3779B97F4A7C15ull;
+            word = splitMix64(seed);
+        }
+    }
+
+    static constexpr result_type min() { return 0; }
+    static constexpr result_type max() { return std::numeric_limits<result_type>::max(); }
+
+    result_type operator()() {
+        uint64_t result = rotl(state[1] * 5, 7) * 9;
+        uint64_t t = state[1] << 17;
+        state[2] ^= state[0];
+        state[3] ^= state[1];
+        state[1] ^= state[2];
+        state[0] ^= state[3];
+        state[2] ^= t;
+        state[3] = rotl(state[3], 45);
+        return result;
+    }
+
+    // Uniform in [0, n) by multiply-shift of the top 32 bits. The bias is below n / 2^32,
+    // irrelevant for move counts.
+    uint32_t below(uint32_t n) {
+        return (uint32_t)(((*this)() >> 32) * n >> 32);
+    }
+
+    float uniform() {
+        return ((*this)() >> 40) * (1.0f / (1 << 24));
+    }
+
+private:
+    uint64_t state[4];
+
+    static uint64_t rotl(uint64_t x, int k) {
+        return (x << k) | (x >> (64 - k));
+    }
+};
@@ -0,0 +1,75 @@
+#pragma once
+#include <Position.h>
+#include <Random.h>
+#include <cstddef>
+#include <vector>
+
+struct PlayoutResult {
+    GameOutcome outcome = GameOutcome::Ongoing;
+    const char* result = "Game continues"; // the ChessBoard::getGameResult string
+    size_t plies = 0;
+};
+
+// Plays uniformly random legal moves from position until the game ends or maxPlies moves have
+// been made, leaving position at the final state. Moves are appended to moveLog when given.
+//
+// Instead of building the full legal list every ply, a random pseudo-legal move is made and
+// kept unless it leaves the mover in check, in which case it is dropped and another is drawn.
+// That is still uniform over legal moves, and finding none at all is checkmate or stalemate,
+// so no separate terminal scan is needed. Checks run in getGameResult's order.
+inline PlayoutResult randomPlayout(Position& position, Xoshiro256& rng, std::vector<SquareMove>* moveLog = nullptr,
+                                   size_t maxPlies = (size_t)-1) {
+    PlayoutResult playout;
+    MoveList moves;
+
+    while (playout.plies < maxPlies) {
+        if (position.insufficientMaterial()) {
+            playout.outcome = GameOutcome::Draw;
+            playout.result = "Draw (Insufficient Material)";
+            return playout;
+        }
+
+        bool white = position.whiteToMove;
+        bool fiftyMoves = position.movesSinceCapture >= 50 && position.movesSincePawnMovement >= 50;
+        const char* adjudicated = position.adjudicate(); // applies only once a legal move exists
+        position.generatePseudoLegal(moves);
+
+        while (moves.size > 0) {
+            int pick = (int)rng.below((uint32_t)moves.size);
+            SquareMove move = moves[pick];
+            Position::Undo undo = position.makeMove(move);
+            if (!position.inCheck(white)) {
+                if (fiftyMoves) {
+                    position.unmakeMove(move, undo);
+                    playout.outcome = GameOutcome::Draw;
+                    playout.result = "Draw (50-move rule)";
+                    return playout;
+                }
+                if (adjudicated) {
+                    position.unmakeMove(move, undo);
+                    playout.outcome = outcomeFromResult(adjudicated);
+                    playout.result = adjudicated;
+                    return playout;
+                }
+                if (moveLog) moveLog->push_back(move);
+                playout.plies++;
+                break;
+            }
+            position.unmakeMove(move, undo);
+            moves[pick] = moves[--moves.size];
+        }
+
+        if (moves.size == 0) {
+            if (position.inCheck(white)) {
+                playout.outcome = white ? GameOutcome::BlackWins : GameOutcome::WhiteWins;
+                playout.result = white ? "Black wins (Checkmate)" : "White wins (Checkmate)";
+            }
+            else {
+                playout.outcome = GameOutcome::Draw;
+                playout.result = "Draw (Stalemate)";
+            }
+            return playout;
+        }
+    }
+    return playout;
+}
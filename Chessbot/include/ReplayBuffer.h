@@ -0,0 +1,159 @@
+#pragma once
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <random>
+#include <thread>
+#include <vector>
+
+// Bounded multi-producer multi-consumer queue (Vyukov). Each cell carries a sequence number
+// that tells producers and consumers whether it is free or filled for their lap, so push and
+// pop are a single CAS on the shared position plus one store on the cell.
+template<typename T>
+class BoundedQueue {
+public:
+    explicit BoundedQueue(size_t capacity) {
+        size_t size = 1;
+        while (size < capacity) size <<= 1;
+        mask = size - 1;
+        cells.reset(new Cell[size]);
+        for (size_t i = 0; i < size; ++i)
+            cells[i].sequence.store(i, std::memory_order_relaxed);
+    }
+
+    size_t capacity() const { return mask + 1; }
+
+    bool tryPush(const T& value) {
+        Cell* cell;
+        size_t pos = enqueuePos.load(std::memory_order_relaxed);
+        while (true) {
+            cell = &cells[pos & mask];
+            size_t seq = cell->sequence.load(std::memory_order_acquire);
+            intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+            if (diff == 0) {
+                if (enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+            }
+            else if (diff < 0) {
+                return false; // full
+            }
+            else {
+                pos = enqueuePos.load(std::memory_order_relaxed);
+            }
+        }
+        cell->value = value;
+        cell->sequence.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool tryPop(T& value) {
+        Cell* cell;
+        size_t pos = dequeuePos.load(std::memory_order_relaxed);
+        while (true) {
+            cell = &cells[pos & mask];
+            size_t seq = cell->sequence.load(std::memory_order_acquire);
+            intptr_t diff = (intptr_t)seq - (intptr_t)(pos + 1);
+            if (diff == 0) {
+                if (dequeuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+            }
+            else if (diff < 0) {
+                return false; // empty
+            }
+            else {
+                pos = dequeuePos.load(std::memory_order_relaxed);
+            }
+        }
+        value = std::move(cell->value);
+        cell->sequence.store(pos + mask + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Approximate, for reporting only
+    size_t size() const {
+        size_t enq = enqueuePos.load(std::memory_order_relaxed);
+        size_t deq = dequeuePos.load(std::memory_order_relaxed);
+        return enq > deq ? enq - deq : 0;
+    }
+
+private:
+    struct Cell {
+        std::atomic<size_t> sequence;
+        T value;
+    };
+
+    std::unique_ptr<Cell[]> cells;
+    size_t mask = 0;
+    alignas(64) std::atomic<size_t> enqueuePos{ 0 };
+    alignas(64) std::atomic<size_t> dequeuePos{ 0 };
+};
+
+// Producers push into a bounded lock-free queue and wait (backpressure) while it is full.
+// The consumer drains the queue into a sliding window that only it touches, and samples
+// mini-batches uniformly from that window, so neither side ever takes a lock.
+template<typename T>
+class ReplayBuffer {
+public:
+    struct Counters {
+        std::atomic<size_t> pushed{ 0 };
+        std::atomic<size_t> producerWaits{ 0 }; // push attempts that found the queue full
+        std::atomic<size_t> drained{ 0 };
+        std::atomic<size_t> sampled{ 0 };
+    };
+
+    ReplayBuffer(size_t queueCapacity, size_t windowCapacity)
+        : queue(queueCapacity), windowCapacity(windowCapacity) {
+        window.reserve(windowCapacity);
+    }
+
+    // Blocks while the queue is full. Returns false if stop was raised while waiting.
+    bool push(const T& value, const std::atomic<bool>& stop) {
+        while (!queue.tryPush(value)) {
+            counters.producerWaits.fetch_add(1, std::memory_order_relaxed);
+            if (stop.load(std::memory_order_relaxed)) return false;
+            std::this_thread::yield();
+        }
+        counters.pushed.fetch_add(1, std::memory_order_relaxed);
+        return true;
+    }
+
+    // Consumer only. Moves up to maxItems queued items into the window, overwriting the oldest.
+    size_t drain(size_t maxItems = SIZE_MAX) {
+        size_t count = 0;
+        T value;
+        while (count < maxItems && queue.tryPop(value)) {
+            if (window.size() < windowCapacity) {
+                window.push_back(std::move(value));
+            }
+            else {
+                window[writeIndex] = std::move(value);
+                writeIndex = (writeIndex + 1) % windowCapacity;
+            }
+            count++;
+        }
+        counters.drained.fetch_add(count, std::memory_order_relaxed);
+        return count;
+    }
+
+    // Consumer only. Samples with replacement from the window.
+    template<typename Rng>
+    void sample(size_t batchSize, Rng& rng, std::vector<const T*>& batch) {
+        assert(!window.empty());
+        batch.clear();
+        std::uniform_int_distribution<size_t> dist(0, window.size() - 1);
+        for (size_t i = 0; i < batchSize; ++i)
+            batch.push_back(&window[dist(rng)]);
+        counters.sampled.fetch_add(batchSize, std::memory_order_relaxed);
+    }
+
+    size_t windowSize() const { return window.size(); }
+    size_t queued() const { return queue.size(); }
+
+    Counters counters;
+
+private:
+    BoundedQueue<T> queue;
+    std::vector<T> window;
+    size_t windowCapacity;
+    size_t writeIndex = 0;
+};
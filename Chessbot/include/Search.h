@@ -0,0 +1,349 @@
+#pragma once
+#include <NeuralNetwork.h>
+#include <Position.h>
+#include <Tablebase.h>
+#include <TranspositionTable.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+struct SearchLimits {
+    int maxDepth = 64;
+    uint64_t maxNodes = 0;  // 0 = no limit
+    double maxMillis = 0.0; // 0 = no limit
+    double softMillis = 0.0; // no new iteration starts after this; 0 = no limit
+    const std::atomic<bool>* stop = nullptr; // set from another thread to end the search early
+    // While set, the search runs without time or node budgets; they start counting when another
+    // thread clears it (a ponder hit)
+    const std::atomic<bool>* pondering = nullptr;
+};
+
+struct SearchResult {
+    SquareMove bestMove;
+    bool hasMove = false;
+    int score = 0;  // centipawns from the side to move, or +-(MateScore - plies) for mates
+    int depth = 0;  // last fully searched depth
+    uint64_t nodes = 0;
+    double seconds = 0.0;
+    std::vector<SquareMove> pv;
+};
+
+// Negamax alpha-beta with iterative deepening and a captures-only quiescence search over
+// Position make/unmake. The network has no value head, so leaves are scored by material and the
+// network's policy output orders quiet moves at nodes with enough depth left to pay for a forward
+// pass. The move from the last completed iteration is returned when the budget runs out.
+// An optional transposition table, which may be shared with other searches running on other
+// threads, supplies cutoffs and the first move to try. With a tablebase installed, positions it
+// covers are scored as won, drawn or lost below the root; actual mates still score higher.
+class Search {
+public:
+    static constexpr int MateScore = 30000;
+    static constexpr int MaxPly = 128;
+    static constexpr int TablebaseScore = 20000; // won tablebase position, beyond any material balance
+    int policyOrderingDepth = 2; // remaining depth at which quiet moves are ordered by the network
+    // Called after every completed iteration, e.g. for UCI info lines
+    std::function<void(const SearchResult&)> onIteration;
+
+    explicit Search(const NeuralNetwork& network, TranspositionTable* table = nullptr)
+        : network(network), table(table), input(772, 1) {}
+
+    static int pieceValue(Piece p) {
+        static const int values[13] = { 0, 100, 500, 300, 300, 900, 0, 100, 500, 300, 300, 900, 0 };
+        return values[(int)p];
+    }
+
+    // Material balance from the side to move
+    static int evaluate(const Position& position) {
+        int score = 0;
+        for (int p = (int)Piece::WhitePawn; p <= (int)Piece::WhiteKing; ++p)
+            score += position.pieceCounts[p] * pieceValue((Piece)p);
+        for (int p = (int)Piece::BlackPawn; p <= (int)Piece::BlackKing; ++p)
+            score -= position.pieceCounts[p] * pieceValue((Piece)p);
+        return position.whiteToMove ? score : -score;
+    }
+
+    // ChessBot::encodeBoard's layout for the side to move, written in place into one column
+    static void encode(const Position& position, Matrix& input, size_t column = 0) {
+        PROFILE_SCOPE(ProfileZone::EncodeBoard);
+        bool white = position.whiteToMove;
+        for (int square = 0; square < 64; ++square) {
+            int piece = perspectivePiece((int)position.squares[perspectiveSquare(square, white)], white);
+            for (int i = 0; i < 12; ++i)
+                input.data[square * 12 + i][column] = (i == piece - 1) ? 1.f : 0.f;
+        }
+        input.data[768][column] = 1.f;
+        input.data[769][column] = 0.f;
+        input.data[770][column] = position.movesSinceCapture / 50.f;
+        input.data[771][column] = position.movesSincePawnMovement / 50.f;
+    }
+
+    SearchResult search(const Position& root, const SearchLimits& limits) {
+        position = root;
+        this->limits = limits;
+        nodes = 0;
+        aborted = false;
+        previousPV.clear();
+        start = budgetStart = std::chrono::steady_clock::now();
+        budgetStartNodes = 0;
+        ponderActive = limits.pondering && limits.pondering->load();
+        if (table) table->newSearch();
+
+        SearchResult result;
+        for (int depth = 1; depth <= std::min(limits.maxDepth, MaxPly - 1); ++depth) {
+            followingPV = true;
+            int score = negamax(depth, 0, -MateScore - 1, MateScore + 1);
+            if (aborted) break;
+
+            result.depth = depth;
+            result.score = score;
+            result.pv.assign(pvTable[0], pvTable[0] + pvLength[0]);
+            previousPV = result.pv;
+            result.hasMove = pvLength[0] > 0;
+            if (result.hasMove) result.bestMove = pvTable[0][0];
+            if (onIteration) {
+                result.nodes = nodes;
+                result.seconds = elapsedMillis() / 1000.0;
+                onIteration(result);
+            }
+            // A forced mate or a terminal root won't change with more depth
+            if (!result.hasMove || std::abs(score) >= MateScore - MaxPly) break;
+            // Another iteration would likely be cut off by maxMillis anyway
+            if (limits.softMillis > 0.0 && !pondering() && budgetMillis() >= limits.softMillis) break;
+        }
+
+        // Budget ran out before depth 1 finished: any legal move beats none
+        if (!result.hasMove) {
+            MoveList legal;
+            position = root;
+            position.generateLegal(legal);
+            if (legal.size > 0) {
+                result.bestMove = legal[0];
+                result.hasMove = true;
+            }
+        }
+
+        result.nodes = nodes;
+        result.seconds = elapsedMillis() / 1000.0;
+        return result;
+    }
+
+private:
+    const NeuralNetwork& network;
+    TranspositionTable* table;
+    Matrix input;
+    Position position;
+    SearchLimits limits;
+    uint64_t nodes = 0;
+    bool aborted = false;
+    std::vector<SquareMove> previousPV;
+    bool followingPV = false; // on the previous iteration's PV so far
+    std::chrono::steady_clock::time_point start;
+    std::chrono::steady_clock::time_point budgetStart; // when the budgets started counting
+    uint64_t budgetStartNodes = 0;
+    bool ponderActive = false;
+    SquareMove pvTable[MaxPly][MaxPly];
+    int pvLength[MaxPly] = {};
+
+    double elapsedMillis() const {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    double budgetMillis() const {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - budgetStart).count();
+    }
+
+    // Whether the budgets are still suspended; restarts them the first time pondering has ended
+    bool pondering() {
+        if (!ponderActive) return false;
+        if (limits.pondering->load(std::memory_order_relaxed)) return true;
+        ponderActive = false;
+        budgetStart = std::chrono::steady_clock::now();
+        budgetStartNodes = nodes;
+        return false;
+    }
+
+    bool outOfBudget() {
+        if (limits.stop && limits.stop->load(std::memory_order_relaxed)) aborted = true;
+        if (pondering()) return aborted;
+        if (limits.maxNodes && nodes - budgetStartNodes >= limits.maxNodes) aborted = true;
+        if (limits.maxMillis > 0.0 && (nodes & 63) == 0 && budgetMillis() >= limits.maxMillis) aborted = true;
+        return aborted;
+    }
+
+    // Mate scores are stored relative to the node so they stay correct at any ply
+    static int scoreToTable(int score, int ply) {
+        if (score >= MateScore - MaxPly) return score + ply;
+        if (score <= -MateScore + MaxPly) return score - ply;
+        return score;
+    }
+
+    static int scoreFromTable(int score, int ply) {
+        if (score >= MateScore - MaxPly) return score - ply;
+        if (score <= -MateScore + MaxPly) return score + ply;
+        return score;
+    }
+
+    // Previous iteration's PV move first, then the table's move, then captures by most valuable
+    // victim / least valuable attacker, then quiet moves by the policy logits of their squares
+    void scoreMoves(const MoveList& moves, int* scores, int ply, bool usePolicy, const TTHit& hit) {
+        const Matrix* policy = nullptr;
+        Matrix output;
+        if (usePolicy) {
+            encode(position, input);
+            output = network.forward(input);
+            policy = &output;
+        }
+
+        for (int i = 0; i < moves.size; ++i) {
+            const SquareMove& move = moves[i];
+            Piece victim = position.squares[move.to];
+            if (followingPV && ply < (int)previousPV.size() && previousPV[ply] == move) {
+                scores[i] = 1 << 30;
+            }
+            else if (hit.hasMove && hit.move == move) {
+                scores[i] = 1 << 29;
+            }
+            else if (victim != Piece::Empty) {
+                scores[i] = (1 << 20) + pieceValue(victim) * 16 - pieceValue(position.squares[move.from]) / 16;
+            }
+            else if (policy) {
+                bool white = position.whiteToMove;
+                float logits = policy->data[perspectiveSquare(move.from, white)][0] +
+                               policy->data[64 + perspectiveSquare(move.to, white)][0];
+                scores[i] = (int)std::max(-(1 << 19) + 1.f, std::min((1 << 19) - 1.f, logits * 1024.f));
+            }
+            else {
+                scores[i] = 0;
+            }
+        }
+    }
+
+    static void pickNext(MoveList& moves, int* scores, int from) {
+        int best = from;
+        for (int i = from + 1; i < moves.size; ++i)
+            if (scores[i] > scores[best]) best = i;
+        std::swap(moves[from], moves[best]);
+        std::swap(scores[from], scores[best]);
+    }
+
+    int negamax(int depth, int ply, int alpha, int beta) {
+        pvLength[ply] = 0;
+        if (position.insufficientMaterial()) return 0;
+        if (ply > 0 && position.pieceTotal() <= Tablebase::MaxPieces && Tablebase::installed()) {
+            int score;
+            if (probeTablebase(ply, score)) return score;
+        }
+        if (depth <= 0 || ply >= MaxPly - 1) return quiescence(ply, alpha, beta);
+
+        nodes++;
+        if (outOfBudget()) return 0;
+
+        bool white = position.whiteToMove;
+        if (position.movesSinceCapture >= 50 && position.movesSincePawnMovement >= 50)
+            return position.hasLegalMove() ? 0 : (position.inCheck(white) ? -MateScore + ply : 0);
+
+        TTHit hit;
+        if (table && table->probe(position.hash, hit) && ply > 0 && hit.depth >= depth) {
+            int score = scoreFromTable(hit.score, ply);
+            if (hit.bound == Bound::Exact) return score;
+            if (hit.bound == Bound::Lower && score >= beta) return score;
+            if (hit.bound == Bound::Upper && score <= alpha) return score;
+        }
+
+        MoveList moves;
+        int scores[256];
+        position.generatePseudoLegal(moves);
+        scoreMoves(moves, scores, ply, depth >= policyOrderingDepth, hit);
+
+        int originalAlpha = alpha;
+        SquareMove bestMove;
+        bool hasBestMove = false;
+        int legalMoves = 0;
+        for (int i = 0; i < moves.size; ++i) {
+            pickNext(moves, scores, i);
+            SquareMove move = moves[i];
+            Position::Undo undo = position.makeMove(move);
+            if (table) table->prefetch(position.hash);
+            if (position.inCheck(white)) {
+                position.unmakeMove(move, undo);
+                continue;
+            }
+            legalMoves++;
+
+            bool parentFollowingPV = followingPV;
+            followingPV = followingPV && ply < (int)previousPV.size() && previousPV[ply] == move;
+            int score = -negamax(depth - 1, ply + 1, -beta, -alpha);
+            followingPV = parentFollowingPV;
+            position.unmakeMove(move, undo);
+            if (aborted) return 0;
+
+            if (score > alpha) {
+                alpha = score;
+                bestMove = move;
+                hasBestMove = true;
+                pvTable[ply][0] = move;
+                std::copy(pvTable[ply + 1], pvTable[ply + 1] + pvLength[ply + 1], pvTable[ply] + 1);
+                pvLength[ply] = pvLength[ply + 1] + 1;
+                if (alpha >= beta) break;
+            }
+        }
+
+        if (legalMoves == 0) return position.inCheck(white) ? -MateScore + ply : 0;
+
+        if (table) {
+            Bound bound = alpha >= beta ? Bound::Lower : alpha > originalAlpha ? Bound::Exact : Bound::Upper;
+            table->store(position.hash, bestMove, hasBestMove, scoreToTable(alpha, ply), depth, bound);
+        }
+        return alpha;
+    }
+
+    // Checks in getGameResult's order, so a mate on the board isn't flattened to a tablebase win
+    bool probeTablebase(int ply, int& score) {
+        WDL wdl = Tablebase::installed()->probe(position);
+        if (wdl == WDL::None) return false;
+        nodes++;
+        if (!position.hasLegalMove()) score = position.inCheck(position.whiteToMove) ? -MateScore + ply : 0;
+        else if (position.movesSinceCapture >= 50 && position.movesSincePawnMovement >= 50) score = 0;
+        else score = wdl == WDL::Win ? TablebaseScore : wdl == WDL::Loss ? -TablebaseScore : 0;
+        return true;
+    }
+
+    int quiescence(int ply, int alpha, int beta) {
+        pvLength[ply] = 0;
+        nodes++;
+        if (outOfBudget()) return 0;
+
+        int standPat = evaluate(position);
+        if (standPat >= beta || ply >= MaxPly - 1) return standPat;
+        alpha = std::max(alpha, standPat);
+
+        bool white = position.whiteToMove;
+        MoveList moves;
+        int scores[256];
+        position.generatePseudoLegal(moves, true);
+        for (int i = 0; i < moves.size; ++i)
+            scores[i] = pieceValue(position.squares[moves[i].to]) * 16 - pieceValue(position.squares[moves[i].from]) / 16;
+
+        for (int i = 0; i < moves.size; ++i) {
+            pickNext(moves, scores, i);
+            SquareMove move = moves[i];
+            Position::Undo undo = position.makeMove(move);
+            if (position.inCheck(white)) {
+                position.unmakeMove(move, undo);
+                continue;
+            }
+            int score = -quiescence(ply + 1, -beta, -alpha);
+            position.unmakeMove(move, undo);
+            if (aborted) return 0;
+
+            if (score > alpha) {
+                alpha = score;
+                if (alpha >= beta) break;
+            }
+        }
+        return alpha;
+    }
+};
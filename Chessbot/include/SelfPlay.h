@@ -0,0 +1,323 @@
+#pragma once
+#include <Adjudication.h>
+#include <ChessBot.h>
+#include <RandomPlayout.h>
+#include <ThreadPool.h>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+
+struct GameRecord {
+    size_t index = 0;
+    uint64_t seed = 0;
+    std::vector<Move> moves;
+    std::string result;
+    std::string adjudication; // verdict adjudication reached, also in games played out; empty if none
+};
+
+struct SelfPlayConfig {
+    size_t threads = std::thread::hardware_concurrency();
+    size_t games = 1;
+    uint64_t seed = 0;
+    bool botVsBot = true; // false plays uniformly random legal moves
+    // Bot games open with this many uniformly random legal moves drawn from the game seed. The
+    // bots pick their moves deterministically, so without an opening every game played with the
+    // same networks (prototypes, or lockstep, which shares one pair) is the same game.
+    size_t openingPlies = 8;
+    // When > 1, each worker advances this many bot games in lockstep and evaluates all
+    // positions of a side with one forwardBatch call. Needs the same networks for every game,
+    // so without prototypes one pair is drawn from seed, where unbatched games each draw their
+    // own; only the openings then tell lockstep games apart.
+    size_t lockstepGames = 0;
+    // Network outputs shared by all workers' bots; 0 disables the cache. Fresh networks never
+    // hit, and with shared networks and random openings positions rarely recur: 128 games from
+    // 8-ply openings hit 0%, and 2-ply openings 20% only from repeated openings. It pays off
+    // when the same positions are evaluated again, as with openingPlies = 0.
+    size_t evalCacheEntries = 0;
+    // Both sides of a bot game play with one network, which halves the resident weights and
+    // lets lockstep batches mix both colors. false gives each side its own fresh network.
+    // Ignored when the runner is given two different prototype networks.
+    bool sharedNetwork = true;
+    AdjudicationConfig adjudication; // bot games only
+};
+
+struct SelfPlayStats {
+    size_t games = 0;
+    size_t plies = 0;
+    double seconds = 0.0;
+    EvalCacheStats cache;
+    size_t adjudicated = 0;        // games ended by adjudication
+    size_t sampledVerdicts = 0;    // played-out games where adjudication reached a verdict
+    size_t falseAdjudications = 0; // of those, verdicts the actual result contradicted
+
+    double gamesPerSecond() const { return seconds > 0.0 ? games / seconds : 0.0; }
+    double pliesPerSecond() const { return seconds > 0.0 ? plies / seconds : 0.0; }
+
+    void print() const {
+        std::cout << games << " games, " << plies << " plies in " << seconds << "s ("
+                  << gamesPerSecond() << " games/s, " << pliesPerSecond() << " plies/s)" << std::endl;
+        if (cache.hits + cache.misses) cache.print();
+        if (adjudicated + sampledVerdicts)
+            std::cout << adjudicated << " games adjudicated, " << falseAdjudications << " of " << sampledVerdicts
+                      << " played-out verdicts contradicted by the result" << std::endl;
+    }
+};
+
+struct LockstepSlot {
+    Xoshiro256 rng;
+    ChessBoard board;
+    bool whiteTurn = true;
+    bool active = false;
+    GameRecord record;
+    Adjudication adjudication;
+};
+
+// Everything a worker touches while playing, created on the worker's own thread and
+// reused for every game it runs
+struct SelfPlayWorker {
+    Xoshiro256 rng;
+    ChessBot white;
+    ChessBot black;
+    std::vector<SquareMove> playoutMoves;
+    GameRecord record;
+    Adjudication adjudication;
+    std::vector<LockstepSlot> slots;
+
+    explicit SelfPlayWorker(bool sharedNetwork)
+        : white(true), black(sharedNetwork ? ChessBot(false, white.chessnet) : ChessBot(false)) {}
+    SelfPlayWorker(const NeuralNetwork& whiteNet, const NeuralNetwork& blackNet) : white(true, whiteNet), black(false, blackNet) {}
+    // One copy of network played by both sides
+    explicit SelfPlayWorker(const NeuralNetwork& network) : white(true, network), black(false, white.chessnet) {}
+
+    bool sharesNetwork() const { return white.chessnet == black.chessnet; }
+};
+
+// Plays games on a work-stealing pool. Every game gets a seed derived from the base seed
+// and its index, so a game's moves don't depend on which worker ran it or in what order.
+class SelfPlayRunner {
+public:
+    // Called on the worker thread that finished the game, so it must be thread-safe
+    using GameCallback = std::function<void(size_t workerIndex, const GameRecord& game)>;
+
+    // Each bot game gets freshly initialized networks seeded from the game seed, as simulateBotVsBot does
+    explicit SelfPlayRunner(const SelfPlayConfig& config) : config(config) {}
+
+    // Every game uses copies of these networks; passing the same network for both sides makes
+    // each worker hold a single copy shared by both bots
+    SelfPlayRunner(const SelfPlayConfig& config, const NeuralNetwork& whiteNet, const NeuralNetwork& blackNet)
+        : config(config), whitePrototype(new NeuralNetwork(whiteNet)),
+          blackPrototype(&whiteNet == &blackNet ? whitePrototype : std::make_shared<NeuralNetwork>(blackNet)) {}
+
+    SelfPlayRunner(const SelfPlayConfig& config, const NeuralNetwork& network)
+        : SelfPlayRunner(config, network, network) {}
+
+    static uint64_t gameSeed(uint64_t baseSeed, size_t gameIndex) {
+        return splitMix64(baseSeed ^ splitMix64(gameIndex));
+    }
+
+    SelfPlayStats run(const GameCallback& onGame = nullptr) {
+        bool lockstep = config.botVsBot && config.lockstepGames > 1;
+        if (lockstep && !whitePrototype) {
+            whitePrototype.reset(new NeuralNetwork(772, 128, { 500, 500 }, (unsigned int)config.seed));
+            blackPrototype = config.sharedNetwork ? whitePrototype
+                           : std::make_shared<NeuralNetwork>(772, 128, std::vector<size_t>{ 500, 500 }, (unsigned int)(config.seed >> 32) + 1);
+        }
+
+        std::unique_ptr<EvalCache> cache(config.evalCacheEntries ? new EvalCache(config.evalCacheEntries) : nullptr);
+        ThreadPool pool(config.threads);
+        std::vector<std::unique_ptr<SelfPlayWorker>> workers(pool.size());
+        std::atomic<size_t> plies{ 0 };
+        std::atomic<size_t> nextGame{ 0 };
+        std::atomic<size_t> adjudicated{ 0 }, sampledVerdicts{ 0 }, falseAdjudications{ 0 };
+
+        auto finishGame = [&](size_t workerIndex, const GameRecord& game) {
+            plies += game.moves.size();
+            if (!game.adjudication.empty() && game.result == game.adjudication) adjudicated++;
+            else if (!game.adjudication.empty()) {
+                sampledVerdicts++;
+                if (outcomeFromResult(game.adjudication) != outcomeFromResult(game.result)) falseAdjudications++;
+            }
+            if (onGame) onGame(workerIndex, game);
+        };
+
+        auto getWorker = [&](size_t workerIndex) -> SelfPlayWorker& {
+            auto& worker = workers[workerIndex];
+            if (!worker) {
+                if (!whitePrototype) worker.reset(new SelfPlayWorker(config.sharedNetwork));
+                else if (whitePrototype == blackPrototype) worker.reset(new SelfPlayWorker(*whitePrototype));
+                else worker.reset(new SelfPlayWorker(*whitePrototype, *blackPrototype));
+                worker->white.evalCache = worker->black.evalCache = cache.get();
+            }
+            return *worker;
+        };
+
+        auto start = std::chrono::steady_clock::now();
+        if (lockstep) {
+            // One long-running task per worker; finished slots pull the next game index
+            for (size_t i = 0; i < pool.size(); ++i) {
+                pool.submit([&](size_t workerIndex) {
+                    playLockstep(getWorker(workerIndex), workerIndex, nextGame, finishGame);
+                });
+            }
+        }
+        else {
+            for (size_t i = 0; i < config.games; ++i) {
+                pool.submit([&, i](size_t workerIndex) {
+                    SelfPlayWorker& worker = getWorker(workerIndex);
+                    playGame(worker, i);
+                    finishGame(workerIndex, worker.record);
+                });
+            }
+        }
+        pool.waitIdle();
+
+        SelfPlayStats stats;
+        stats.games = config.games;
+        stats.plies = plies;
+        stats.adjudicated = adjudicated;
+        stats.sampledVerdicts = sampledVerdicts;
+        stats.falseAdjudications = falseAdjudications;
+        stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        if (cache) stats.cache = cache->stats();
+        return stats;
+    }
+
+private:
+    SelfPlayConfig config;
+    std::shared_ptr<NeuralNetwork> whitePrototype;
+    std::shared_ptr<NeuralNetwork> blackPrototype; // the same object as whitePrototype when shared
+
+    void startRecord(GameRecord& record, size_t gameIndex) {
+        record.index = gameIndex;
+        record.seed = gameSeed(config.seed, gameIndex);
+        record.moves.clear();
+        record.result.clear();
+        record.adjudication.clear();
+    }
+
+    // Plays the random opening from the start position into board, recording its moves
+    void playOpening(Xoshiro256& rng, GameRecord& record, ChessBoard& board, bool& whiteTurn) const {
+        Position position = Position::startPosition();
+        MoveList legal;
+        for (size_t ply = 0; ply < config.openingPlies; ++ply) {
+            position.generateLegal(legal);
+            if (legal.size == 0 || position.gameResult() != "Game continues") break;
+            SquareMove move = legal[rng.below(legal.size)];
+            record.moves.push_back(move.toMove());
+            position.makeMove(move);
+        }
+        board = position.toChessBoard();
+        whiteTurn = position.whiteToMove;
+    }
+
+    // True when adjudication ends the game at this position, with record.result set
+    bool adjudicate(Adjudication& adjudication, const ChessBoard& board, GameRecord& record) const {
+        if (!config.adjudication.enabled) return false;
+        const char* verdict = adjudication.update(config.adjudication, board);
+        if (!verdict) return false;
+        record.adjudication = verdict;
+        if (adjudication.playOut) return false;
+        record.result = verdict;
+        return true;
+    }
+
+    void playGame(SelfPlayWorker& worker, size_t gameIndex) {
+        GameRecord& record = worker.record;
+        startRecord(record, gameIndex);
+        worker.rng.seed(record.seed);
+
+        if (config.botVsBot && !whitePrototype) {
+            worker.white.chessnet->initialize((unsigned int)record.seed);
+            if (!worker.sharesNetwork()) worker.black.chessnet->initialize((unsigned int)(record.seed >> 32));
+        }
+
+        if (!config.botVsBot) {
+            Position position = Position::startPosition();
+            worker.playoutMoves.clear();
+            record.result = randomPlayout(position, worker.rng, &worker.playoutMoves).result;
+            for (const SquareMove& move : worker.playoutMoves)
+                record.moves.push_back(move.toMove());
+            return;
+        }
+
+        ChessBoard board;
+        bool whiteTurn = true;
+        playOpening(worker.rng, record, board, whiteTurn);
+        worker.adjudication.reset(config.adjudication, record.seed);
+
+        while (true) {
+            record.result = board.getGameResult(whiteTurn);
+            if (record.result != "Game continues") break;
+            if (adjudicate(worker.adjudication, board, record)) break;
+
+            Move move = (whiteTurn ? worker.white : worker.black).decideMove(board);
+            record.moves.push_back(move);
+            board.makeMove(move);
+            whiteTurn = !whiteTurn;
+        }
+    }
+
+    void playLockstep(SelfPlayWorker& worker, size_t workerIndex, std::atomic<size_t>& nextGame,
+                      const GameCallback& finishGame) {
+        auto startGame = [&](LockstepSlot& slot) {
+            size_t gameIndex = nextGame++;
+            slot.active = gameIndex < config.games;
+            if (!slot.active) return;
+            startRecord(slot.record, gameIndex);
+            slot.rng.seed(slot.record.seed);
+            playOpening(slot.rng, slot.record, slot.board, slot.whiteTurn);
+            slot.adjudication.reset(config.adjudication, slot.record.seed);
+        };
+
+        worker.slots.resize(config.lockstepGames);
+        for (LockstepSlot& slot : worker.slots)
+            startGame(slot);
+
+        // With one shared network every mover goes into a single batch (list 1) whatever its color
+        bool shared = worker.sharesNetwork();
+        std::vector<const ChessBoard*> boards[2];
+        std::vector<LockstepSlot*> movers[2];
+        std::vector<bool> whiteToMove[2];
+
+        while (true) {
+            for (int side = 0; side < 2; ++side) {
+                boards[side].clear();
+                movers[side].clear();
+                whiteToMove[side].clear();
+            }
+
+            for (LockstepSlot& slot : worker.slots) {
+                // Finished games are reported and their slot immediately reused
+                while (slot.active) {
+                    slot.record.result = slot.board.getGameResult(slot.whiteTurn);
+                    if (slot.record.result == "Game continues" && !adjudicate(slot.adjudication, slot.board, slot.record)) break;
+                    finishGame(workerIndex, slot.record);
+                    startGame(slot);
+                }
+                if (!slot.active) continue;
+
+                int side = shared || slot.whiteTurn;
+                boards[side].push_back(&slot.board);
+                movers[side].push_back(&slot);
+                whiteToMove[side].push_back(slot.whiteTurn);
+            }
+
+            if (movers[0].empty() && movers[1].empty()) break;
+
+            for (int side = 0; side < 2; ++side) {
+                if (movers[side].empty()) continue;
+
+                ChessBot& bot = side ? worker.white : worker.black;
+                std::vector<Move> moves = bot.decideMoves(boards[side], whiteToMove[side]);
+                for (size_t i = 0; i < moves.size(); ++i) {
+                    LockstepSlot& slot = *movers[side][i];
+                    slot.record.moves.push_back(moves[i]);
+                    slot.board.makeMove(moves[i]);
+                    slot.whiteTurn = !slot.whiteTurn;
+                }
+            }
+        }
+    }
+};
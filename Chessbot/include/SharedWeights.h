@@ -0,0 +1,186 @@
+#pragma once
+#include <NeuralNetwork.h>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <new>
+#include <string>
+#include <vector>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Network weights in a POSIX shared-memory segment (/dev/shm), written by one coordinator
+// process and mapped read-only by self-play worker processes on the same host.
+//
+// The segment holds two weight buffers, each guarded by a seqlock. A publish writes the buffer
+// readers aren't directed to and then flips latest, so the coordinator never waits on workers
+// and a worker always finds a complete set; a copy that a second publish overwrote midway is
+// detected by the sequence number and retried.
+class SharedWeights {
+public:
+    static constexpr uint32_t MaxLayers = 8;
+
+    struct Header {
+        char magic[4];                          // "CBSW"
+        uint32_t layerCount;
+        uint64_t layerSizes[MaxLayers + 1];     // input size, hidden sizes, output size
+        uint64_t parameters;                    // floats per buffer
+        std::atomic<uint64_t> version;          // publications so far
+        std::atomic<uint32_t> latest;           // buffer holding the newest weights
+        std::atomic<uint32_t> shutdown;         // set by the coordinator to stop the workers
+        std::atomic<uint64_t> sequence[2];      // odd while the buffer is being written
+    };
+    static_assert(std::atomic<uint64_t>::is_always_lock_free, "Shared atomics must be lock-free");
+
+    // Coordinator: creates the segment, replacing any stale one of the same name, and publishes
+    // initial. The segment is unlinked again when this object is destroyed.
+    SharedWeights(const std::string& name, const NeuralNetwork& initial) : name(name), owner(true) {
+        shm_unlink(name.c_str());
+        int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+        if (fd < 0) {
+            std::cerr << "Error: Could not create shared memory '" << name << "'" << std::endl;
+            return;
+        }
+        size_t parameters = parameterCount(initial);
+        length = sizeof(Header) + 2 * parameters * sizeof(float);
+        void* mapping = ftruncate(fd, (off_t)length) == 0 ? mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0) : MAP_FAILED;
+        ::close(fd);
+        if (mapping == MAP_FAILED) {
+            std::cerr << "Error: Could not map shared memory '" << name << "'" << std::endl;
+            shm_unlink(name.c_str());
+            return;
+        }
+
+        header = new (mapping) Header();
+        std::memcpy(header->magic, "CBSW", 4);
+        header->layerCount = (uint32_t)initial.layerCount;
+        header->layerSizes[0] = initial.inputSize;
+        for (size_t i = 0; i < initial.layerCount; ++i)
+            header->layerSizes[i + 1] = initial.weights[i].rows;
+        header->parameters = parameters;
+        publish(initial);
+    }
+
+    // Worker: maps an existing segment read-only
+    explicit SharedWeights(const std::string& name) : name(name), owner(false) {
+        int fd = shm_open(name.c_str(), O_RDONLY, 0);
+        if (fd < 0) {
+            std::cerr << "Error: Could not open shared memory '" << name << "'" << std::endl;
+            return;
+        }
+        struct stat info;
+        void* mapping = fstat(fd, &info) == 0 && (size_t)info.st_size >= sizeof(Header)
+            ? mmap(nullptr, (size_t)info.st_size, PROT_READ, MAP_SHARED, fd, 0) : MAP_FAILED;
+        ::close(fd);
+        if (mapping == MAP_FAILED) return;
+        length = (size_t)info.st_size;
+        header = static_cast<Header*>(mapping);
+        if (std::memcmp(header->magic, "CBSW", 4) != 0 || header->layerCount > MaxLayers ||
+            length < sizeof(Header) + 2 * header->parameters * sizeof(float)) {
+            std::cerr << "Error: '" << name << "' is not a weight segment" << std::endl;
+            close();
+        }
+    }
+
+    ~SharedWeights() {
+        close();
+        if (owner) shm_unlink(name.c_str());
+    }
+
+    SharedWeights(const SharedWeights&) = delete;
+    SharedWeights& operator=(const SharedWeights&) = delete;
+
+    bool isOpen() const { return header != nullptr; }
+
+    // Coordinator only; network must have the segment's architecture
+    void publish(const NeuralNetwork& network) {
+        uint32_t target = 1 - header->latest.load(std::memory_order_relaxed);
+        std::atomic<uint64_t>& sequence = header->sequence[target];
+        sequence.store(sequence.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+
+        float* out = buffer(target);
+        for (size_t i = 0; i < network.layerCount; ++i) {
+            for (const auto& row : network.weights[i].data) {
+                std::memcpy(out, row.data(), row.size() * sizeof(float));
+                out += row.size();
+            }
+            for (const auto& row : network.biases[i].data)
+                *out++ = row[0];
+        }
+
+        sequence.store(sequence.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+        header->latest.store(target, std::memory_order_release);
+        header->version.fetch_add(1, std::memory_order_release);
+    }
+
+    uint64_t version() const {
+        return header->version.load(std::memory_order_acquire);
+    }
+
+    // Copies the newest weights into network, which must have the segment's architecture (see
+    // makeNetwork); returns the version copied
+    uint64_t read(NeuralNetwork& network) const {
+        while (true) {
+            uint64_t version = this->version();
+            uint32_t source = header->latest.load(std::memory_order_acquire);
+            const std::atomic<uint64_t>& sequence = header->sequence[source];
+            uint64_t before = sequence.load(std::memory_order_acquire);
+            if (before & 1) continue;
+
+            const float* in = buffer(source);
+            for (size_t i = 0; i < network.layerCount; ++i) {
+                for (auto& row : network.weights[i].data) {
+                    std::memcpy(row.data(), in, row.size() * sizeof(float));
+                    in += row.size();
+                }
+                for (auto& row : network.biases[i].data)
+                    row[0] = *in++;
+            }
+
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (sequence.load(std::memory_order_relaxed) != before) continue;
+            network.bumpVersion();
+            return version;
+        }
+    }
+
+    // A network with the segment's architecture, holding the newest weights
+    NeuralNetwork makeNetwork() const {
+        std::vector<size_t> hidden(header->layerSizes + 1, header->layerSizes + header->layerCount);
+        NeuralNetwork network(header->layerSizes[0], header->layerSizes[header->layerCount], hidden, 0);
+        read(network);
+        return network;
+    }
+
+    void requestShutdown() { header->shutdown.store(1, std::memory_order_release); }
+    bool shutdownRequested() const { return header->shutdown.load(std::memory_order_acquire) != 0; }
+
+    static size_t parameterCount(const NeuralNetwork& network) {
+        size_t count = 0;
+        for (size_t i = 0; i < network.layerCount; ++i)
+            count += network.weights[i].rows * (network.weights[i].cols + 1);
+        return count;
+    }
+
+private:
+    std::string name;
+    bool owner;
+    Header* header = nullptr;
+    size_t length = 0;
+
+    float* buffer(uint32_t index) const {
+        return reinterpret_cast<float*>(reinterpret_cast<uint8_t*>(header) + sizeof(Header)) + index * header->parameters;
+    }
+
+    void close() {
+        if (header) munmap(header, length);
+        header = nullptr;
+    }
+};
+#endif
@@ -0,0 +1,176 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+// Read-copy-update for a value one writer replaces while many threads read it, e.g. network
+// weights the trainer publishes to self-play threads. Every publish makes a new immutable
+// snapshot and swaps it in with one atomic exchange; readers never lock or copy.
+//
+// Replaced snapshots are freed by epoch-based reclamation. A reader pins the snapshot it
+// acquires by recording the global epoch in its slot until the guard is released; publish
+// bumps the epoch and frees retired snapshots older than every pinned epoch. A reader that
+// keeps a guard only delays reclamation, it never blocks the writer.
+template<typename T>
+class SnapshotPublisher {
+    struct Slot;
+
+public:
+    static constexpr size_t MaxReaders = 64;
+
+    struct Snapshot {
+        T value;
+        uint64_t version;
+    };
+
+    // Keeps one snapshot alive; at most one per Reader at a time
+    class Guard {
+    public:
+        Guard(Guard&& other) noexcept : slot(other.slot), snapshot(other.snapshot) {
+            other.slot = nullptr;
+        }
+        Guard(const Guard&) = delete;
+        Guard& operator=(const Guard&) = delete;
+        Guard& operator=(Guard&&) = delete;
+
+        ~Guard() {
+            if (slot) slot->epoch.store(0, std::memory_order_release);
+        }
+
+        const T& operator*() const { return snapshot->value; }
+        const T* operator->() const { return &snapshot->value; }
+        uint64_t version() const { return snapshot->version; }
+
+    private:
+        friend class SnapshotPublisher;
+        Guard(Slot* slot, const Snapshot* snapshot) : slot(slot), snapshot(snapshot) {}
+
+        Slot* slot;
+        const Snapshot* snapshot;
+    };
+
+    // A reader thread's slot, claimed for the reader's lifetime. Not shared between threads.
+    class Reader {
+    public:
+        Reader(Reader&& other) noexcept : publisher(other.publisher), slot(other.slot) {
+            other.slot = nullptr;
+        }
+        Reader(const Reader&) = delete;
+        Reader& operator=(const Reader&) = delete;
+        Reader& operator=(Reader&&) = delete;
+
+        ~Reader() {
+            if (!slot) return;
+            assert(slot->epoch.load() == 0 && "Reader released while a guard is still alive");
+            slot->claimed.store(false, std::memory_order_release);
+        }
+
+        Guard acquire() {
+            assert(slot->epoch.load(std::memory_order_relaxed) == 0 && "One guard per reader at a time");
+            // The pinned epoch must be visible before the pointer is read, so a writer that
+            // misses the pin is one whose exchange this load already sees
+            slot->epoch.store(publisher->epoch.load());
+            return Guard(slot, publisher->current.load());
+        }
+
+        // Whether a newer snapshot than guard's has been published
+        bool stale(const Guard& guard) const {
+            return publisher->version() != guard.version();
+        }
+
+    private:
+        friend class SnapshotPublisher;
+        Reader(SnapshotPublisher* publisher, Slot* slot) : publisher(publisher), slot(slot) {}
+
+        SnapshotPublisher* publisher;
+        Slot* slot;
+    };
+
+    explicit SnapshotPublisher(T initial) {
+        current.store(new Snapshot{ std::move(initial), 0 });
+    }
+
+    SnapshotPublisher(const SnapshotPublisher&) = delete;
+    SnapshotPublisher& operator=(const SnapshotPublisher&) = delete;
+
+    // All readers must be gone
+    ~SnapshotPublisher() {
+        delete current.load();
+        for (const Retired& retired : retiredList)
+            delete retired.snapshot;
+    }
+
+    // Throws when MaxReaders readers already exist
+    Reader reader() {
+        for (Slot& slot : slots) {
+            bool expected = false;
+            if (!slot.claimed.load(std::memory_order_relaxed) &&
+                slot.claimed.compare_exchange_strong(expected, true, std::memory_order_acquire))
+                return Reader(this, &slot);
+        }
+        throw std::runtime_error("SnapshotPublisher: too many readers");
+    }
+
+    // Makes value the current snapshot and returns its version. Writers serialize among
+    // themselves; readers are never waited on.
+    uint64_t publish(T value) {
+        Snapshot* snapshot = new Snapshot{ std::move(value), 0 };
+        std::lock_guard<std::mutex> lock(writeMutex);
+        snapshot->version = publishedVersion.load(std::memory_order_relaxed) + 1;
+        Snapshot* previous = current.exchange(snapshot);
+        publishedVersion.store(snapshot->version, std::memory_order_release);
+        retiredList.push_back({ previous, epoch.fetch_add(1) });
+        reclaim();
+        return snapshot->version;
+    }
+
+    uint64_t version() const {
+        return publishedVersion.load(std::memory_order_acquire);
+    }
+
+    // Replaced snapshots still waiting for readers to move on
+    size_t retiredCount() {
+        std::lock_guard<std::mutex> lock(writeMutex);
+        return retiredList.size();
+    }
+
+private:
+    struct alignas(64) Slot {
+        std::atomic<uint64_t> epoch{ 0 }; // pinned epoch, 0 when no guard is held
+        std::atomic<bool> claimed{ false };
+    };
+
+    struct Retired {
+        Snapshot* snapshot;
+        uint64_t epoch; // readers pinned at this epoch or earlier may still hold it
+    };
+
+    std::atomic<Snapshot*> current{ nullptr };
+    std::atomic<uint64_t> epoch{ 1 };
+    std::atomic<uint64_t> publishedVersion{ 0 };
+    std::array<Slot, MaxReaders> slots;
+    std::mutex writeMutex;
+    std::vector<Retired> retiredList;
+
+    void reclaim() {
+        uint64_t oldestPinned = UINT64_MAX;
+        for (const Slot& slot : slots) {
+            uint64_t pinned = slot.epoch.load();
+            if (pinned != 0 && pinned < oldestPinned) oldestPinned = pinned;
+        }
+
+        size_t kept = 0;
+        for (const Retired& retired : retiredList) {
+            if (retired.epoch < oldestPinned) delete retired.snapshot;
+            else retiredList[kept++] = retired;
+        }
+        retiredList.resize(kept);
+    }
+};
@@ -0,0 +1,88 @@
+#pragma once
+#include <Matrix.h>
+#include <cstdint>
+#include <vector>
+
+// A pruned weight matrix in compressed sparse row form: row i keeps the weights
+// values[rowStart[i] .. rowStart[i + 1]), in the columns listed at the same positions of
+// columns. Zero entries of the dense matrix are the pruned ones. A kept weight costs 6 bytes
+// against a dense weight's 4, so the product reads less memory below about 2/3 density.
+struct SparseMatrix {
+    size_t rows = 0;
+    size_t cols = 0;
+    std::vector<uint32_t> rowStart;
+    std::vector<uint16_t> columns;
+    std::vector<float> values;
+
+    SparseMatrix() {}
+
+    explicit SparseMatrix(const Matrix& dense) : rows(dense.rows), cols(dense.cols) {
+        assert(cols <= 65536);
+        rowStart.reserve(rows + 1);
+        rowStart.push_back(0);
+        for (const std::vector<float>& row : dense.data) {
+            for (size_t c = 0; c < cols; ++c) {
+                if (row[c] == 0.f) continue;
+                columns.push_back((uint16_t)c);
+                values.push_back(row[c]);
+            }
+            rowStart.push_back((uint32_t)values.size());
+        }
+    }
+
+    bool empty() const { return rows == 0; }
+    size_t nonZeros() const { return values.size(); }
+    double density() const { return rows * cols > 0 ? (double)values.size() / (rows * cols) : 1.0; }
+
+    size_t memoryBytes() const {
+        return rowStart.size() * sizeof(uint32_t) + columns.size() * sizeof(uint16_t) + values.size() * sizeof(float);
+    }
+
+    // Zeroes the entries of dense outside the kept pattern and copies the kept ones, for dense
+    // weights written since the pattern was taken
+    void sync(Matrix& dense) {
+        assert(dense.rows == rows && dense.cols == cols);
+        for (size_t r = 0; r < rows; ++r) {
+            std::vector<float>& row = dense.data[r];
+            uint32_t p = rowStart[r], end = rowStart[r + 1];
+            for (size_t c = 0; c < cols; ++c) {
+                if (p < end && columns[p] == c) values[p++] = row[c];
+                else row[c] = 0.f;
+            }
+        }
+    }
+
+    // Same result as the dense product with the pruned weights, to the bit: each output still
+    // sums its terms in column order and only the exact zeros are skipped
+    Matrix operator*(const Matrix& other) const {
+        assert(cols == other.rows);
+        Matrix result(rows, other.cols);
+        if (other.cols == 1) {
+            // Gather the column once so each row is a dot product over contiguous memory
+            std::vector<float> x(other.rows);
+            for (size_t k = 0; k < other.rows; ++k)
+                x[k] = other.data[k][0];
+            for (size_t i = 0; i < rows; ++i)
+                result.data[i][0] = rowDot(i, x);
+            return result;
+        }
+        // i-p-j like the dense product, so the inner loop runs over the batch
+        for (size_t i = 0; i < rows; ++i) {
+            std::vector<float>& out = result.data[i];
+            for (uint32_t p = rowStart[i]; p < rowStart[i + 1]; ++p) {
+                float a = values[p];
+                const std::vector<float>& row = other.data[columns[p]];
+                for (size_t j = 0; j < other.cols; ++j)
+                    out[j] += a * row[j];
+            }
+        }
+        return result;
+    }
+
+    // sum plus the row's dot product with x, added in the same order as the dense loop
+    float rowDot(size_t row, const std::vector<float>& x, float sum = 0.f) const {
+        for (uint32_t p = rowStart[row]; p < rowStart[row + 1]; ++p)
+            sum += values[p] * x[columns[p]];
+        return sum;
+    }
+};
@@ -0,0 +1,320 @@
+#pragma once
+#include <ChessBoard.h>
+#include <MappedFile.h>
+#include <Position.h>
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Result for the side to move; None when the position isn't covered
+enum class WDL : uint8_t { Draw, Win, Loss, None };
+
+struct TBPiece {
+    Piece piece;
+    int square;
+};
+
+// Win/draw/loss tables for every material with at most MaxPieces pieces, kings included, built
+// by TablebaseGenerator. Entries are 2 bits, indexed by side to move, the white king's square
+// (mirrored onto files a-d, which needs no castling rights) and the other pieces' squares in a
+// fixed order. Colors are swapped so the stronger side is always white in the table.
+//
+// Entries are results under this variant's rules, 50-move rule included, at a zeroed counter, as
+// right after a capture or a pawn move. A promotion counts as a queen move, as in
+// ChessBoard::makeMove, so it zeroes the counter only when it captures. A win has to reach mate,
+// or a zeroing move into another won position, within CounterPlies plies. Later in the count a
+// position can only be worth less, so probes of a Position or ChessBoard with plies on the
+// counter return draws and None otherwise.
+//
+// File layout: TBHeader, then the packed entries. Files are memory-mapped, so a probe costs one
+// random read once the pages are resident.
+class Tablebase {
+public:
+    static constexpr int MaxPieces = 4;
+    static constexpr int CounterPlies = 50; // plies without a capture or pawn move that draw the game
+    static constexpr uint32_t FileVersion = 2; // 1 ignored the 50-move rule
+
+    struct TBHeader {
+        char magic[4];       // "CBTB"
+        uint32_t version;
+        uint32_t material;   // materialKey of the table's pieces
+        uint32_t pieceCount;
+    };
+
+    Tablebase() = default;
+
+    explicit Tablebase(const std::string& directory) {
+        load(directory);
+    }
+
+    Tablebase(const Tablebase&) = delete;
+    Tablebase& operator=(const Tablebase&) = delete;
+
+    // Maps every .cbtb file in directory; returns how many tables were loaded
+    size_t load(const std::string& directory) {
+        size_t loaded = 0;
+        std::error_code error;
+        if (!std::filesystem::is_directory(directory, error)) return 0;
+        for (const auto& entry : std::filesystem::directory_iterator(directory)) {
+            if (!entry.is_regular_file() || entry.path().extension() != ".cbtb") continue;
+            std::unique_ptr<MappedFile> file(new MappedFile(entry.path().string(), MappedFile::Access::Random));
+            if (!file->isOpen() || file->size() < sizeof(TBHeader)) continue;
+
+            TBHeader header;
+            std::memcpy(&header, file->data(), sizeof(header));
+            size_t entries = tableSize(header.pieceCount);
+            if (std::memcmp(header.magic, "CBTB", 4) != 0 || header.version != FileVersion ||
+                file->size() < sizeof(TBHeader) + (entries + 3) / 4) {
+                std::cerr << "Error: '" << entry.path().string() << "' is not a valid tablebase file" << std::endl;
+                continue;
+            }
+
+            std::unique_ptr<Table> table(new Table());
+            table->material = header.material;
+            table->pieceCount = (int)header.pieceCount;
+            table->entries = entries;
+            table->data = file->data() + sizeof(TBHeader);
+            table->file = std::move(file);
+            add(std::move(table));
+            loaded++;
+        }
+        return loaded;
+    }
+
+    // Adds a table built in memory; packed holds 2-bit entries as in the files
+    void add(uint32_t material, int pieceCount, std::vector<uint8_t> packed) {
+        std::unique_ptr<Table> table(new Table());
+        table->material = material;
+        table->pieceCount = pieceCount;
+        table->entries = tableSize(pieceCount);
+        table->owned = std::move(packed);
+        table->data = table->owned.data();
+        add(std::move(table));
+    }
+
+    bool write(uint32_t material, const std::string& path) const {
+        auto found = byMaterial.find(material);
+        if (found == byMaterial.end()) return false;
+        const Table& table = *tables[found->second];
+        FILE* file = std::fopen(path.c_str(), "wb");
+        if (!file) {
+            std::cerr << "Error: Could not open the file '" << path << "'" << std::endl;
+            return false;
+        }
+        TBHeader header = { { 'C', 'B', 'T', 'B' }, FileVersion, table.material, (uint32_t)table.pieceCount };
+        bool ok = std::fwrite(&header, sizeof(header), 1, file) == 1 &&
+                  std::fwrite(table.data, 1, (table.entries + 3) / 4, file) == (table.entries + 3) / 4;
+        return std::fclose(file) == 0 && ok;
+    }
+
+    size_t tableCount() const { return tables.size(); }
+    bool has(uint32_t material) const { return byMaterial.count(material) != 0; }
+
+    // squares is 64 pieces indexed row * 8 + col, as Position::squares and ChessBoard::board; the
+    // result is the one at a zeroed counter
+    WDL probe(const Piece* squares, bool whiteToMove) const {
+        TBPiece pieces[MaxPieces];
+        int count = 0;
+        for (int square = 0; square < 64; ++square) {
+            if (squares[square] == Piece::Empty) continue;
+            if (count == MaxPieces) return WDL::None;
+            pieces[count++] = { squares[square], square };
+        }
+        return probe(pieces, count, whiteToMove);
+    }
+
+    WDL probe(const Position& position) const {
+        if (position.pieceTotal() > MaxPieces) return WDL::None;
+        return atCounter(probe(position.squares.data(), position.whiteToMove),
+                         std::min(position.movesSinceCapture, position.movesSincePawnMovement));
+    }
+
+    WDL probe(const ChessBoard& board, bool whiteToMove) const {
+        return atCounter(probe(&board.board[0][0], whiteToMove),
+                         std::min(board.getMovesSinceCapture(), board.getMovesSincePawnMovement()));
+    }
+
+    // A zeroed-counter result pliesSinceZeroing plies into the count: a win or loss there may
+    // have become a draw, so only draws are kept
+    static WDL atCounter(WDL wdl, int pliesSinceZeroing) {
+        return pliesSinceZeroing == 0 || wdl == WDL::Draw ? wdl : WDL::None;
+    }
+
+    // Insufficient material is a draw by rule and needs no table
+    WDL probe(const TBPiece* pieces, int count, bool whiteToMove) const {
+        if (count > MaxPieces || count < 2) return WDL::None;
+        if (insufficientMaterial(pieces, count)) return WDL::Draw;
+
+        uint32_t material;
+        size_t i = tableIndex(pieces, count, whiteToMove, material);
+        auto found = byMaterial.find(material);
+        if (found == byMaterial.end()) return WDL::None;
+        const Table& table = *tables[found->second];
+        int value = (table.data[i >> 2] >> ((i & 3) * 2)) & 3;
+        return (WDL)value; // 3 marks an illegal position, which reads as None
+    }
+
+    // Makes getGameResult, Position::gameResult, random playouts and Search adjudicate covered
+    // positions through tablebase. Install before starting threads that play games.
+    static void install(const Tablebase* tablebase) {
+        installedTablebase() = tablebase;
+        adjudicator().adjudicate = tablebase ? &adjudicate : nullptr;
+        adjudicator().maxPieces = tablebase ? MaxPieces : 0;
+    }
+
+    static const Tablebase* installed() { return installedTablebase(); }
+
+    static const char* resultString(WDL wdl, bool whiteToMove) {
+        if (wdl == WDL::Draw) return "Draw (Tablebase)";
+        if (wdl == WDL::None) return "Game continues";
+        return (wdl == WDL::Win) == whiteToMove ? "White wins (Tablebase)" : "Black wins (Tablebase)";
+    }
+
+    // 2 bits per non-king piece type and color: white pawn..queen, then black pawn..queen
+    static uint32_t materialKey(const TBPiece* pieces, int count) {
+        uint32_t key = 0;
+        for (int i = 0; i < count; ++i) {
+            int slot = pieceSlot(pieces[i].piece);
+            if (slot >= 0) key += 1u << (2 * slot);
+        }
+        return key;
+    }
+
+    static uint32_t flipMaterial(uint32_t material) {
+        return (material >> 10) | ((material & 1023) << 10);
+    }
+
+    // White holds the side with more material value, ties broken by the key itself
+    static bool isCanonical(uint32_t material) {
+        uint32_t white = material & 1023, black = material >> 10;
+        int whiteValue = sideValue(white), blackValue = sideValue(black);
+        return whiteValue != blackValue ? whiteValue > blackValue : white >= black;
+    }
+
+    // e.g. "KRPvK"
+    static std::string materialName(uint32_t material) {
+        const char symbols[] = "PRNBQ";
+        const int order[] = { 4, 1, 3, 2, 0 };
+        std::string name;
+        for (int side = 0; side < 2; ++side) {
+            name += side ? "vK" : "K";
+            for (int type : order)
+                name.append((material >> (2 * (side * 5 + type))) & 3, symbols[type]);
+        }
+        return name;
+    }
+
+    static size_t tableSize(int pieceCount) {
+        return (size_t)2 * 32 << (6 * (pieceCount - 1));
+    }
+
+    // squares[0] is the white king, squares[1] the black king, the rest in table order
+    static size_t index(const int* squares, int count, bool whiteToMove) {
+        int mirror = (squares[0] & 7) >= 4 ? 7 : 0;
+        size_t i = (whiteToMove ? 0 : 1) * 32 + (squares[0] >> 3) * 4 + ((squares[0] ^ mirror) & 7);
+        for (int k = 1; k < count; ++k)
+            i = i * 64 + (squares[k] ^ mirror);
+        return i;
+    }
+
+    // Index of a position in the table of its canonical material, which is stored in material
+    static size_t tableIndex(const TBPiece* pieces, int count, bool whiteToMove, uint32_t& material) {
+        material = materialKey(pieces, count);
+        bool flip = !isCanonical(material);
+        if (flip) material = flipMaterial(material);
+        int squares[MaxPieces] = {};
+        tableOrder(pieces, count, flip, squares);
+        return index(squares, count, whiteToMove != flip);
+    }
+
+    // Sorts pieces into table order: kings, then the rest by piece, optionally color-flipped
+    static void tableOrder(const TBPiece* pieces, int count, bool flip, int* squares) {
+        TBPiece ordered[MaxPieces];
+        int others = 2;
+        for (int i = 0; i < count; ++i) {
+            TBPiece piece = pieces[i];
+            if (flip) piece = { (Piece)perspectivePiece((int)piece.piece, false), piece.square ^ 56 };
+            if (piece.piece == Piece::WhiteKing) ordered[0] = piece;
+            else if (piece.piece == Piece::BlackKing) ordered[1] = piece;
+            else {
+                int k = others++;
+                while (k > 2 && ordered[k - 1].piece > piece.piece) {
+                    ordered[k] = ordered[k - 1];
+                    k--;
+                }
+                ordered[k] = piece;
+            }
+        }
+        for (int i = 0; i < count; ++i)
+            squares[i] = ordered[i].square;
+    }
+
+    // Same rule as ChessBoard::insufficientMaterial
+    static bool insufficientMaterial(const TBPiece* pieces, int count) {
+        if (count == 2) return true;
+        if (count != 3) return false;
+        for (int i = 0; i < count; ++i) {
+            Piece p = pieces[i].piece;
+            if (p == Piece::WhiteBishop || p == Piece::BlackBishop || p == Piece::WhiteKnight || p == Piece::BlackKnight)
+                return true;
+        }
+        return false;
+    }
+
+private:
+    struct Table {
+        uint32_t material = 0;
+        int pieceCount = 0;
+        size_t entries = 0;
+        const uint8_t* data = nullptr;
+        std::unique_ptr<MappedFile> file;
+        std::vector<uint8_t> owned;
+    };
+
+    std::vector<std::unique_ptr<Table>> tables;
+    std::unordered_map<uint32_t, size_t> byMaterial;
+
+    void add(std::unique_ptr<Table> table) {
+        auto found = byMaterial.find(table->material);
+        if (found != byMaterial.end()) {
+            tables[found->second] = std::move(table);
+            return;
+        }
+        byMaterial[table->material] = tables.size();
+        tables.push_back(std::move(table));
+    }
+
+    static int pieceSlot(Piece p) {
+        int v = (int)p;
+        if (v >= (int)Piece::WhitePawn && v <= (int)Piece::WhiteQueen) return v - 1;
+        if (v >= (int)Piece::BlackPawn && v <= (int)Piece::BlackQueen) return v - 2;
+        return -1;
+    }
+
+    static int sideValue(uint32_t side) {
+        const int values[5] = { 1, 5, 3, 3, 9 };
+        int value = 0;
+        for (int type = 0; type < 5; ++type)
+            value += ((side >> (2 * type)) & 3) * values[type];
+        return value;
+    }
+
+    static const Tablebase*& installedTablebase() {
+        static const Tablebase* tablebase = nullptr;
+        return tablebase;
+    }
+
+    static const char* adjudicate(const Piece* squares, bool whiteToMove, int pliesSinceZeroing) {
+        const Tablebase* tablebase = installedTablebase();
+        if (!tablebase) return nullptr;
+        WDL wdl = atCounter(tablebase->probe(squares, whiteToMove), pliesSinceZeroing);
+        return wdl == WDL::None ? nullptr : resultString(wdl, whiteToMove);
+    }
+};
@@ -0,0 +1,394 @@
+#pragma once
+#include <Tablebase.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+struct TablebaseBuildStats {
+    std::string name;
+    size_t positions = 0; // legal positions in the table
+    size_t wins = 0;
+    size_t losses = 0;
+    size_t draws = 0;
+    size_t passes = 0;
+    double seconds = 0.0;
+
+    void print() const {
+        std::cout << name << ": " << positions << " positions, " << wins << " wins, " << losses << " losses, "
+                  << draws << " draws, " << passes << " passes in " << seconds << "s" << std::endl;
+    }
+};
+
+// Builds Tablebase tables by retrograde iteration. Checkmate and stalemate are scored first; then
+// pass n marks a position won when some move reaches a position lost for the opponent, and lost
+// when every move reaches one won for the opponent, reading only targets resolved on earlier
+// passes, so whatever pass n resolves is decided in n plies. Captures and pawn pushes zero the
+// 50-move counter, so they're scored by their target's final result instead (smaller tables built
+// earlier, or pawn structures further advanced, which are built first). A promotion without a
+// capture counts as a queen move and carries the counter into the queen's table, so it needs the
+// pass that resolved its target there; the generator keeps those for tables with a queen and
+// rebuilds tables loaded from files when a promotion needs them. After Tablebase::CounterPlies
+// passes, or once a pass changes nothing, what's left is drawn.
+//
+// Move generation is a small piece-list generator for this variant (no castling or en passant,
+// promotion to a queen); with at most four pieces it is much faster than scanning a board.
+class TablebaseGenerator {
+public:
+    explicit TablebaseGenerator(Tablebase& tablebase) : tablebase(tablebase) {}
+
+    // Canonical materials with up to maxPieces pieces in an order where every capture and
+    // promotion leads to a table earlier in the list. Drawn-by-rule materials are left out.
+    static std::vector<uint32_t> materials(int maxPieces) {
+        std::vector<uint32_t> result;
+        const int others = std::min(maxPieces, Tablebase::MaxPieces) - 2;
+        // Every way to place up to `others` pieces from the 10 non-king piece slots
+        std::vector<int> slots;
+        std::function<void(int)> choose = [&](int first) {
+            if (!slots.empty()) {
+                TBPiece pieces[Tablebase::MaxPieces] = { { Piece::WhiteKing, 0 }, { Piece::BlackKing, 0 } };
+                int count = 2;
+                for (int slot : slots)
+                    pieces[count++] = { (Piece)(slot < 5 ? slot + 1 : slot + 2), 0 };
+                uint32_t key = Tablebase::materialKey(pieces, count);
+                if (Tablebase::isCanonical(key) && !Tablebase::insufficientMaterial(pieces, count) &&
+                    std::find(result.begin(), result.end(), key) == result.end())
+                    result.push_back(key);
+            }
+            if ((int)slots.size() == others) return;
+            for (int slot = first; slot < 10; ++slot) {
+                slots.push_back(slot);
+                choose(slot);
+                slots.pop_back();
+            }
+        };
+        choose(0);
+
+        // Fewer pieces first, then fewer pawns: a promotion trades a pawn for a queen
+        auto pawns = [](uint32_t key) { return (key & 3) + ((key >> 10) & 3); };
+        auto pieces = [](uint32_t key) {
+            int total = 0;
+            for (int slot = 0; slot < 10; ++slot) total += (key >> (2 * slot)) & 3;
+            return total;
+        };
+        std::stable_sort(result.begin(), result.end(), [&](uint32_t a, uint32_t b) {
+            if (pieces(a) != pieces(b)) return pieces(a) < pieces(b);
+            return pawns(a) < pawns(b);
+        });
+        return result;
+    }
+
+    // Builds the table for material and adds it to the tablebase, first rebuilding any table its
+    // promotions lead into that was loaded rather than built here
+    TablebaseBuildStats generate(uint32_t material) {
+        for (uint32_t target : promotionTargets(material))
+            if (!promotionPasses.count(target)) generate(target);
+
+        auto start = std::chrono::steady_clock::now();
+        TablebaseBuildStats stats;
+        stats.name = Tablebase::materialName(material);
+
+        count = 2;
+        types[0] = Piece::WhiteKing;
+        types[1] = Piece::BlackKing;
+        for (int slot = 0; slot < 10; ++slot)
+            for (uint32_t n = 0; n < ((material >> (2 * slot)) & 3); ++n)
+                types[count++] = (Piece)(slot < 5 ? slot + 1 : slot + 2);
+        std::sort(types + 2, types + count);
+
+        size_t entries = Tablebase::tableSize(count);
+        state.assign(entries, Unknown);
+        pass.assign(entries, 0);
+        std::vector<std::vector<uint32_t>> byAdvancement; // unresolved positions
+
+        Node node;
+        for (size_t i = 0; i < entries; ++i) {
+            if (!decode(i, node)) {
+                state[i] = Illegal;
+                continue;
+            }
+            stats.positions++;
+            uint8_t value = evaluate(node, 0);
+            if (value != Unknown) {
+                state[i] = value;
+                continue;
+            }
+            size_t level = advancement(node);
+            if (level >= byAdvancement.size()) byAdvancement.resize(level + 1);
+            byAdvancement[level].push_back((uint32_t)i);
+        }
+
+        for (size_t level = byAdvancement.size(); level-- > 0;) {
+            std::vector<uint32_t>& unresolved = byAdvancement[level];
+            for (int n = 1; n <= Tablebase::CounterPlies && !unresolved.empty(); ++n) {
+                stats.passes++;
+                size_t kept = 0;
+                for (uint32_t i : unresolved) {
+                    decode(i, node);
+                    uint8_t value = evaluate(node, n);
+                    if (value == Unknown) {
+                        unresolved[kept++] = i;
+                    }
+                    else {
+                        state[i] = value;
+                        pass[i] = (uint8_t)n;
+                    }
+                }
+                bool changed = kept != unresolved.size();
+                unresolved.resize(kept);
+                if (!changed) break;
+            }
+            // Final before any less advanced level pushes a pawn into them
+            for (uint32_t i : unresolved)
+                state[i] = Draw;
+        }
+
+        std::vector<uint8_t> packed((entries + 3) / 4, 0);
+        for (size_t i = 0; i < entries; ++i) {
+            WDL wdl = state[i] == Win ? WDL::Win : state[i] == Loss ? WDL::Loss : state[i] == Illegal ? WDL::None : WDL::Draw;
+            stats.wins += state[i] == Win;
+            stats.losses += state[i] == Loss;
+            packed[i >> 2] |= (uint8_t)((int)wdl << ((i & 3) * 2));
+        }
+        stats.draws = stats.positions - stats.wins - stats.losses;
+        tablebase.add(material, count, std::move(packed));
+        state.clear();
+        state.shrink_to_fit();
+        if (hasQueen(material)) promotionPasses[material] = std::move(pass);
+        pass.clear();
+        pass.shrink_to_fit();
+
+        stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        return stats;
+    }
+
+private:
+    enum : uint8_t { Unknown, Win, Loss, Draw, Illegal };
+
+    struct Node {
+        int squares[Tablebase::MaxPieces];
+        bool whiteToMove;
+    };
+
+    Tablebase& tablebase;
+    Piece types[Tablebase::MaxPieces];
+    int count = 0;
+    std::vector<uint8_t> state;
+    std::vector<uint8_t> pass; // pass that resolved each position, 0 for checkmate and stalemate
+    std::unordered_map<uint32_t, std::vector<uint8_t>> promotionPasses; // pass of every table with a queen
+
+    static bool hasQueen(uint32_t material) {
+        return ((material >> 8) & 3) || ((material >> 18) & 3);
+    }
+
+    // Canonical materials reached by promoting a pawn of material without capturing
+    static std::vector<uint32_t> promotionTargets(uint32_t material) {
+        std::vector<uint32_t> targets;
+        for (int side = 0; side < 2; ++side) {
+            int pawnSlot = side * 5, queenSlot = side * 5 + 4;
+            if (((material >> (2 * pawnSlot)) & 3) == 0) continue;
+            uint32_t target = material - (1u << (2 * pawnSlot)) + (1u << (2 * queenSlot));
+            if (!Tablebase::isCanonical(target)) target = Tablebase::flipMaterial(target);
+            targets.push_back(target);
+        }
+        return targets;
+    }
+
+    static bool isWhite(Piece p) { return p >= Piece::WhitePawn && p <= Piece::WhiteKing; }
+
+    int pieceAt(const int* squares, int square, int skip = -1) const {
+        for (int k = 0; k < count; ++k)
+            if (k != skip && squares[k] == square) return k;
+        return -1;
+    }
+
+    // Whether square is attacked by the pieces of one color, ignoring piece `skip` (captured)
+    bool attacked(const int* squares, int square, bool byWhite, int skip) const {
+        int r = square / 8, c = square % 8;
+        for (int k = 0; k < count; ++k) {
+            if (k == skip || isWhite(types[k]) != byWhite) continue;
+            int pr = squares[k] / 8, pc = squares[k] % 8;
+            int dr = r - pr, dc = c - pc;
+            switch (types[k]) {
+            case Piece::WhitePawn:
+                if (dr == 1 && (dc == 1 || dc == -1)) return true;
+                break;
+            case Piece::BlackPawn:
+                if (dr == -1 && (dc == 1 || dc == -1)) return true;
+                break;
+            case Piece::WhiteKnight: case Piece::BlackKnight:
+                if ((std::abs(dr) == 1 && std::abs(dc) == 2) || (std::abs(dr) == 2 && std::abs(dc) == 1)) return true;
+                break;
+            case Piece::WhiteKing: case Piece::BlackKing:
+                if (std::max(std::abs(dr), std::abs(dc)) == 1) return true;
+                break;
+            default: {
+                bool straight = dr == 0 || dc == 0;
+                bool diagonal = std::abs(dr) == std::abs(dc);
+                bool rook = types[k] == Piece::WhiteRook || types[k] == Piece::BlackRook;
+                bool bishop = types[k] == Piece::WhiteBishop || types[k] == Piece::BlackBishop;
+                if ((dr == 0 && dc == 0) || !(straight || diagonal)) break;
+                if ((rook && !straight) || (bishop && !diagonal)) break;
+                int sr = (dr > 0) - (dr < 0), sc = (dc > 0) - (dc < 0);
+                bool blocked = false;
+                for (int rr = pr + sr, cc = pc + sc; rr != r || cc != c; rr += sr, cc += sc) {
+                    if (pieceAt(squares, rr * 8 + cc, skip) >= 0) {
+                        blocked = true;
+                        break;
+                    }
+                }
+                if (!blocked) return true;
+            }
+            }
+        }
+        return false;
+    }
+
+    bool decode(size_t i, Node& node) const {
+        for (int k = count - 1; k >= 1; --k) {
+            node.squares[k] = (int)(i & 63);
+            i >>= 6;
+        }
+        int king = (int)(i % 32);
+        node.squares[0] = (king / 4) * 8 + king % 4;
+        node.whiteToMove = i / 32 == 0;
+
+        for (int k = 0; k < count; ++k) {
+            for (int j = 0; j < k; ++j)
+                if (node.squares[j] == node.squares[k]) return false;
+            int row = node.squares[k] / 8;
+            if ((types[k] == Piece::WhitePawn || types[k] == Piece::BlackPawn) && (row == 0 || row == 7)) return false;
+        }
+        // The side that just moved can't have left its king attacked
+        return !attacked(node.squares, node.squares[node.whiteToMove ? 1 : 0], node.whiteToMove, -1);
+    }
+
+    // Rows the pawns have advanced in total; a pawn push always raises it
+    int advancement(const Node& node) const {
+        int rows = 0;
+        for (int k = 2; k < count; ++k) {
+            if (types[k] == Piece::WhitePawn) rows += node.squares[k] / 8 - 1;
+            else if (types[k] == Piece::BlackPawn) rows += 6 - node.squares[k] / 8;
+        }
+        return rows;
+    }
+
+    // Value of a position on pass n (see the class comment), or Unknown. Pass 0 only looks for
+    // checkmate and stalemate.
+    uint8_t evaluate(const Node& node, int n) {
+        bool white = node.whiteToMove;
+        int ownKing = white ? 0 : 1;
+        bool anyMove = false, allWin = true;
+        int targets[28];
+
+        for (int k = 0; k < count; ++k) {
+            if (isWhite(types[k]) != white) continue;
+            int moves = generate(node.squares, k, white, targets);
+            for (int m = 0; m < moves; ++m) {
+                int to = targets[m];
+                int captured = pieceAt(node.squares, to);
+                Node child = node;
+                child.squares[k] = to;
+                child.whiteToMove = !white;
+                if (attacked(child.squares, child.squares[ownKing], !white, captured)) continue;
+                anyMove = true;
+                if (n == 0) return Unknown;
+
+                bool pawn = types[k] == Piece::WhitePawn || types[k] == Piece::BlackPawn;
+                bool promotes = pawn && (to / 8 == 7 || to / 8 == 0);
+                uint8_t value;
+                if (captured >= 0 || promotes) {
+                    TBPiece pieces[Tablebase::MaxPieces];
+                    int remaining = 0;
+                    for (int j = 0; j < count; ++j) {
+                        if (j == captured) continue;
+                        Piece p = types[j];
+                        if (j == k && promotes) p = white ? Piece::WhiteQueen : Piece::BlackQueen;
+                        pieces[remaining++] = { p, child.squares[j] };
+                    }
+                    WDL wdl = tablebase.probe(pieces, remaining, !white);
+                    value = wdl == WDL::Win ? Win : wdl == WDL::Loss ? Loss : wdl == WDL::Draw ? Draw : Unknown;
+                    if (value == Unknown)
+                        throw std::runtime_error("tablebase for the material after a capture or promotion is missing");
+                    // A promotion that doesn't capture carries the counter on, so like a move
+                    // inside the table it counts once its target resolved on an earlier pass
+                    if (captured < 0 && value != Draw) {
+                        uint32_t target;
+                        size_t i = Tablebase::tableIndex(pieces, remaining, !white, target);
+                        if (promotionPasses.at(target)[i] >= n) value = Unknown;
+                    }
+                }
+                else {
+                    size_t target = Tablebase::index(child.squares, count, child.whiteToMove);
+                    value = pawn || pass[target] < n ? state[target] : (uint8_t)Unknown;
+                }
+
+                if (value == Loss) return Win;
+                if (value != Win) allWin = false;
+            }
+        }
+
+        if (!anyMove) return attacked(node.squares, node.squares[ownKing], !white, -1) ? Loss : Draw;
+        return allWin ? Loss : Unknown;
+    }
+
+    // Pseudo-legal target squares of piece k; own pieces block, enemy pieces can be captured
+    int generate(const int* squares, int k, bool white, int* targets) const {
+        int n = 0;
+        int from = squares[k], r = from / 8, c = from % 8;
+        auto add = [&](int rr, int cc) {
+            if (rr < 0 || rr > 7 || cc < 0 || cc > 7) return false;
+            int occupant = pieceAt(squares, rr * 8 + cc);
+            if (occupant >= 0 && isWhite(types[occupant]) == white) return false;
+            targets[n++] = rr * 8 + cc;
+            return occupant < 0;
+        };
+        auto slide = [&](const int (*dirs)[2], int dirCount) {
+            for (int d = 0; d < dirCount; ++d)
+                for (int i = 1; i < 8 && add(r + i * dirs[d][0], c + i * dirs[d][1]); ++i) {}
+        };
+        static const int straight[4][2] = { { 1, 0 }, { -1, 0 }, { 0, 1 }, { 0, -1 } };
+        static const int diagonal[4][2] = { { 1, 1 }, { 1, -1 }, { -1, 1 }, { -1, -1 } };
+        static const int knight[8][2] = { { -2, 1 }, { -1, 2 }, { 1, 2 }, { 2, 1 }, { 2, -1 }, { 1, -2 }, { -1, -2 }, { -2, -1 } };
+
+        switch (types[k]) {
+        case Piece::WhitePawn: case Piece::BlackPawn: {
+            int dir = white ? 1 : -1, startRow = white ? 1 : 6;
+            if (pieceAt(squares, (r + dir) * 8 + c) < 0) {
+                targets[n++] = (r + dir) * 8 + c;
+                if (r == startRow && pieceAt(squares, (r + 2 * dir) * 8 + c) < 0) targets[n++] = (r + 2 * dir) * 8 + c;
+            }
+            for (int dc = -1; dc <= 1; dc += 2) {
+                if (c + dc < 0 || c + dc > 7) continue;
+                int occupant = pieceAt(squares, (r + dir) * 8 + c + dc);
+                if (occupant >= 0 && isWhite(types[occupant]) != white) targets[n++] = (r + dir) * 8 + c + dc;
+            }
+            break;
+        }
+        case Piece::WhiteKnight: case Piece::BlackKnight:
+            for (const auto& d : knight) add(r + d[0], c + d[1]);
+            break;
+        case Piece::WhiteKing: case Piece::BlackKing:
+            for (int dr = -1; dr <= 1; ++dr)
+                for (int dc = -1; dc <= 1; ++dc)
+                    if (dr || dc) add(r + dr, c + dc);
+            break;
+        case Piece::WhiteRook: case Piece::BlackRook:
+            slide(straight, 4);
+            break;
+        case Piece::WhiteBishop: case Piece::BlackBishop:
+            slide(diagonal, 4);
+            break;
+        default:
+            slide(straight, 4);
+            slide(diagonal, 4);
+            break;
+        }
+        return n;
+    }
+};
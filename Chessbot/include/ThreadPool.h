@@ -0,0 +1,132 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Work-stealing pool. Each worker owns a deque: it pops its own newest task first and,
+// when empty, steals the oldest task from another worker. Tasks receive the index of the
+// worker running them so callers can keep per-worker state without locking.
+class ThreadPool {
+public:
+    using Task = std::function<void(size_t workerIndex)>;
+
+    explicit ThreadPool(size_t threadCount = std::thread::hardware_concurrency()) {
+        if (threadCount == 0) threadCount = 1;
+        for (size_t i = 0; i < threadCount; ++i)
+            queues.emplace_back(new WorkQueue());
+        for (size_t i = 0; i < threadCount; ++i)
+            threads.emplace_back([this, i] { workerLoop(i); });
+    }
+
+    ~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock(sleepMutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (auto& thread : threads)
+            thread.join();
+    }
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    size_t size() const { return threads.size(); }
+
+    // Tasks submitted from a worker go to that worker's own deque, others are spread round-robin
+    void submit(Task task) {
+        size_t target = currentPool() == this ? currentWorker() : nextQueue++ % queues.size();
+        unfinished++;
+        queued++;
+        {
+            std::lock_guard<std::mutex> lock(queues[target]->mutex);
+            queues[target]->tasks.push_back(std::move(task));
+        }
+        {
+            std::lock_guard<std::mutex> lock(sleepMutex);
+        }
+        wake.notify_one();
+    }
+
+    // Blocks until every submitted task has finished
+    void waitIdle() {
+        std::unique_lock<std::mutex> lock(sleepMutex);
+        idle.wait(lock, [this] { return unfinished == 0; });
+    }
+
+private:
+    struct WorkQueue {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    std::vector<std::unique_ptr<WorkQueue>> queues;
+    std::vector<std::thread> threads;
+    std::atomic<size_t> queued{ 0 };     // tasks sitting in a deque
+    std::atomic<size_t> unfinished{ 0 }; // queued plus running
+    std::atomic<size_t> nextQueue{ 0 };
+    std::mutex sleepMutex;
+    std::condition_variable wake;
+    std::condition_variable idle;
+    bool stopping = false;
+
+    static size_t& currentWorker() {
+        static thread_local size_t index = SIZE_MAX;
+        return index;
+    }
+
+    static const ThreadPool*& currentPool() {
+        static thread_local const ThreadPool* pool = nullptr;
+        return pool;
+    }
+
+    bool popOrSteal(size_t self, Task& task) {
+        {
+            WorkQueue& own = *queues[self];
+            std::lock_guard<std::mutex> lock(own.mutex);
+            if (!own.tasks.empty()) {
+                task = std::move(own.tasks.back());
+                own.tasks.pop_back();
+                queued--;
+                return true;
+            }
+        }
+        for (size_t i = 1; i < queues.size(); ++i) {
+            WorkQueue& victim = *queues[(self + i) % queues.size()];
+            std::lock_guard<std::mutex> lock(victim.mutex);
+            if (!victim.tasks.empty()) {
+                task = std::move(victim.tasks.front());
+                victim.tasks.pop_front();
+                queued--;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void workerLoop(size_t self) {
+        currentWorker() = self;
+        currentPool() = this;
+        while (true) {
+            Task task;
+            if (popOrSteal(self, task)) {
+                task(self);
+                if (--unfinished == 0) {
+                    std::lock_guard<std::mutex> lock(sleepMutex);
+                    idle.notify_all();
+                }
+                continue;
+            }
+
+            std::unique_lock<std::mutex> lock(sleepMutex);
+            wake.wait(lock, [this] { return stopping || queued > 0; });
+            if (stopping && queued == 0) return;
+        }
+    }
+};
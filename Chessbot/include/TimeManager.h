@@ -0,0 +1,54 @@
+#pragma once
+#include <Search.h>
+#include <algorithm>
+#include <cstdint>
+
+// Budgets given with a UCI go command, in milliseconds; negative when not given
+struct GoParameters {
+    double whiteTime = -1.0;
+    double blackTime = -1.0;
+    double whiteIncrement = 0.0;
+    double blackIncrement = 0.0;
+    double moveTime = -1.0;
+    int movesToGo = 0;      // moves until the next time control, 0 when sudden death
+    uint64_t nodes = 0;
+    int depth = 0;
+    bool infinite = false;
+};
+
+// Turns a go command into search limits. With a clock, each move gets an even share of the
+// remaining time over the moves expected to be left plus most of the increment as its soft
+// budget: no new iteration starts past it. The hard budget aborts the iteration in progress
+// and allows a few soft budgets for an iteration that was started just in time, but never
+// more than maxShare of what is left on the clock.
+struct TimeManager {
+    double moveOverhead = 30.0;   // milliseconds lost per move to the GUI and the OS
+    int expectedMovesLeft = 30;   // assumed when movesToGo isn't given
+    double incrementShare = 0.75;
+    double hardFactor = 4.0;
+    double maxShare = 0.4;
+
+    SearchLimits allocate(const GoParameters& go, bool whiteToMove) const {
+        SearchLimits limits;
+        if (go.depth > 0) limits.maxDepth = go.depth;
+        limits.maxNodes = go.nodes;
+        if (go.infinite) return limits;
+
+        if (go.moveTime >= 0.0) {
+            limits.maxMillis = std::max(go.moveTime - moveOverhead, 1.0);
+            return limits;
+        }
+
+        double time = whiteToMove ? go.whiteTime : go.blackTime;
+        if (time < 0.0) return limits;
+        double increment = whiteToMove ? go.whiteIncrement : go.blackIncrement;
+        double remaining = std::max(time - moveOverhead, 1.0);
+        int movesLeft = go.movesToGo > 0 ? std::min(go.movesToGo, expectedMovesLeft) : expectedMovesLeft;
+
+        double soft = remaining / movesLeft + increment * incrementShare;
+        double hard = std::min(soft * hardFactor, remaining * (go.movesToGo == 1 ? 0.9 : maxShare));
+        limits.softMillis = std::max(std::min(soft, hard), 1.0);
+        limits.maxMillis = std::max(hard, 1.0);
+        return limits;
+    }
+};
@@ -0,0 +1,267 @@
+#pragma once
+#include <ChessBot.h>
+#include <MappedFile.h>
+#include <Profiler.h>
+#include <SelfPlay.h>
+#include <ThreadPool.h>
+#include <cstdio>
+#include <cstring>
+
+// One training position in 32 bytes. Occupied squares are listed by a bitboard (bit row * 8 + col)
+// and their pieces follow as 4-bit Piece values in square order; at most 32 pieces are ever on the
+// board so 16 bytes always suffice. Files are written in host byte order (little-endian).
+struct PackedPosition {
+    uint64_t occupancy;
+    uint8_t pieces[16];
+    uint16_t movesSincePawnMovement;
+    uint16_t movesSinceCapture;
+    uint16_t move;  // packMove of the move played
+    uint8_t flags;  // bit 0: white to move, bits 1-2: GameOutcome of the game
+    uint8_t reserved;
+
+    bool whiteToMove() const { return flags & 1; }
+    GameOutcome outcome() const { return (GameOutcome)((flags >> 1) & 3); }
+
+    // 1 if the side to move went on to win, -1 if it lost, 0 for a draw
+    float outcomeForMover() const {
+        GameOutcome o = outcome();
+        if (o == GameOutcome::WhiteWins) return whiteToMove() ? 1.f : -1.f;
+        if (o == GameOutcome::BlackWins) return whiteToMove() ? -1.f : 1.f;
+        return 0.f;
+    }
+
+    static PackedPosition pack(const ChessBoard& board, bool whiteToMove, const Move& move, GameOutcome outcome) {
+        PackedPosition packed = {};
+        int count = 0;
+        for (int square = 0; square < 64; ++square) {
+            Piece piece = board.board[square / 8][square % 8];
+            if (piece == Piece::Empty) continue;
+            packed.occupancy |= 1ull << square;
+            packed.pieces[count / 2] |= (uint8_t)((int)piece << ((count % 2) * 4));
+            count++;
+        }
+        packed.movesSincePawnMovement = (uint16_t)board.getMovesSincePawnMovement();
+        packed.movesSinceCapture = (uint16_t)board.getMovesSinceCapture();
+        packed.move = packMove(move);
+        packed.flags = (uint8_t)((whiteToMove ? 1 : 0) | ((int)outcome << 1));
+        return packed;
+    }
+
+    ChessBoard unpack() const {
+        ChessBoard board;
+        int count = 0;
+        for (int square = 0; square < 64; ++square) {
+            Piece piece = Piece::Empty;
+            if (occupancy & (1ull << square)) {
+                piece = (Piece)((pieces[count / 2] >> ((count % 2) * 4)) & 15);
+                count++;
+            }
+            board.board[square / 8][square % 8] = piece;
+        }
+        board.setMoveCounters(movesSincePawnMovement, movesSinceCapture);
+        return board;
+    }
+
+    // Writes the ChessBot::encodeBoard encoding into one column without going through ChessBoard
+    void encodeInto(Matrix& inputs, size_t column) const {
+        bool white = whiteToMove();
+        int count = 0;
+        for (int square = 0; square < 64; ++square) {
+            int piece = 0;
+            if (occupancy & (1ull << square)) {
+                piece = perspectivePiece((pieces[count / 2] >> ((count % 2) * 4)) & 15, white);
+                count++;
+            }
+            int row = perspectiveSquare(square, white) * 12;
+            for (int i = 0; i < 12; ++i)
+                inputs.data[row + i][column] = (i == piece - 1) ? 1.f : 0.f;
+        }
+        inputs.data[768][column] = 1.f;
+        inputs.data[769][column] = 0.f;
+        inputs.data[770][column] = movesSinceCapture / 50.f;
+        inputs.data[771][column] = movesSincePawnMovement / 50.f;
+    }
+
+    // Policy target matching the output layout: half on the from square, half on 64 + to square
+    void targetInto(Matrix& targets, size_t column) const {
+        for (size_t i = 0; i < targets.rows; ++i)
+            targets.data[i][column] = 0.f;
+        targets.data[perspectiveSquare(move & 63, whiteToMove())][column] = 0.5f;
+        targets.data[64 + perspectiveSquare((move >> 6) & 63, whiteToMove())][column] = 0.5f;
+    }
+};
+static_assert(sizeof(PackedPosition) == 32, "PackedPosition must stay 32 bytes");
+
+struct TrainingDataHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t recordSize;
+    uint32_t reserved;
+};
+
+class TrainingDataWriter {
+public:
+    explicit TrainingDataWriter(const std::string& path, bool append = false) {
+        file = std::fopen(path.c_str(), append ? "ab" : "wb");
+        if (!file) {
+            std::cerr << "Error: Could not open the file '" << path << "'" << std::endl;
+            return;
+        }
+        std::setvbuf(file, nullptr, _IOFBF, 1 << 20);
+        std::fseek(file, 0, SEEK_END);
+        if (std::ftell(file) == 0) {
+            TrainingDataHeader header = { { 'C', 'B', 'T', 'D' }, 1, sizeof(PackedPosition), 0 };
+            std::fwrite(&header, sizeof(header), 1, file);
+        }
+    }
+
+    ~TrainingDataWriter() {
+        if (file) std::fclose(file);
+    }
+
+    TrainingDataWriter(const TrainingDataWriter&) = delete;
+    TrainingDataWriter& operator=(const TrainingDataWriter&) = delete;
+
+    bool isOpen() const { return file != nullptr; }
+    size_t recordsWritten() const { return written; }
+
+    void write(const PackedPosition& position) {
+        PROFILE_SCOPE(ProfileZone::FileIO);
+        PROFILE_COUNT(ProfileZone::FileIO, sizeof(position));
+        std::fwrite(&position, sizeof(position), 1, file);
+        written++;
+    }
+
+    // Replays the game and writes one record per ply. Not thread-safe; use one writer per thread.
+    void writeGame(const GameRecord& game) {
+        GameOutcome outcome = outcomeFromResult(game.result);
+        ChessBoard board;
+        bool whiteTurn = true;
+        for (const Move& move : game.moves) {
+            write(PackedPosition::pack(board, whiteTurn, move, outcome));
+            board.makeMove(move);
+            whiteTurn = !whiteTurn;
+        }
+    }
+
+    void flush() {
+        std::fflush(file);
+    }
+
+private:
+    std::FILE* file = nullptr;
+    size_t written = 0;
+};
+
+struct TrainingBatch {
+    Matrix inputs;  // 772 x n in ChessBot::encodeBoard layout
+    Matrix targets; // 128 x n, see PackedPosition::targetInto
+    std::vector<float> outcomes;
+
+    size_t size() const { return outcomes.size(); }
+};
+
+// Streams a memory-mapped training file in shuffled order without loading it. Blocks of
+// consecutive records are visited in random order (sequential I/O within a block) and
+// pass through a fixed-size shuffle buffer that emits a random resident record for each
+// one read. Decoding a batch is split across a small thread pool.
+class TrainingDataReader {
+public:
+    TrainingDataReader(const std::string& path, size_t shuffleBufferSize = 1 << 20, uint64_t seed = 0,
+                       size_t decodeThreads = std::thread::hardware_concurrency(), size_t blockSize = 4096)
+        : file(path, MappedFile::Access::Random), bufferCapacity(std::max<size_t>(shuffleBufferSize, 1)),
+          blockSize(std::max<size_t>(blockSize, 1)), decoders(decodeThreads) {
+        const TrainingDataHeader* header = reinterpret_cast<const TrainingDataHeader*>(file.data());
+        if (!file.isOpen() || file.size() < sizeof(TrainingDataHeader) || std::memcmp(header->magic, "CBTD", 4) != 0 ||
+            header->recordSize != sizeof(PackedPosition)) {
+            std::cerr << "Error: '" << path << "' is not a training data file" << std::endl;
+            file.close();
+            return;
+        }
+        records = reinterpret_cast<const PackedPosition*>(file.data() + sizeof(TrainingDataHeader));
+        count = (file.size() - sizeof(TrainingDataHeader)) / sizeof(PackedPosition);
+        reset(seed);
+    }
+
+    bool isOpen() const { return file.isOpen(); }
+    size_t recordCount() const { return count; }
+
+    // Starts a new epoch with a fresh block order
+    void reset(uint64_t seed) {
+        rng.seed(seed);
+        blockOrder.clear();
+        for (size_t start = 0; start < count; start += blockSize)
+            blockOrder.push_back(start);
+        std::shuffle(blockOrder.begin(), blockOrder.end(), rng);
+        nextBlock = 0;
+        cursor = end = 0;
+        buffer.clear();
+    }
+
+    // Fills batch with up to batchSize records and returns how many. 0 means the epoch is over.
+    size_t nextBatch(size_t batchSize, TrainingBatch& batch) {
+        selected.clear();
+        while (selected.size() < batchSize) {
+            const PackedPosition* incoming = nextIncoming();
+            while (incoming && buffer.size() < bufferCapacity) {
+                buffer.push_back(incoming);
+                incoming = nextIncoming();
+            }
+            if (buffer.empty()) break;
+
+            std::uniform_int_distribution<size_t> dist(0, buffer.size() - 1);
+            size_t pick = dist(rng);
+            selected.push_back(buffer[pick]);
+            if (incoming) {
+                buffer[pick] = incoming;
+            }
+            else {
+                buffer[pick] = buffer.back();
+                buffer.pop_back();
+            }
+        }
+
+        size_t n = selected.size();
+        if (batch.inputs.rows != 772 || batch.inputs.cols != n) batch.inputs = Matrix(772, n);
+        if (batch.targets.rows != 128 || batch.targets.cols != n) batch.targets = Matrix(128, n);
+        batch.outcomes.resize(n);
+
+        size_t chunk = (n + decoders.size() - 1) / std::max<size_t>(decoders.size(), 1);
+        for (size_t begin = 0; begin < n; begin += chunk) {
+            size_t stop = std::min(n, begin + chunk);
+            decoders.submit([this, &batch, begin, stop](size_t) {
+                for (size_t i = begin; i < stop; ++i) {
+                    selected[i]->encodeInto(batch.inputs, i);
+                    selected[i]->targetInto(batch.targets, i);
+                    batch.outcomes[i] = selected[i]->outcomeForMover();
+                }
+            });
+        }
+        decoders.waitIdle();
+        return n;
+    }
+
+private:
+    MappedFile file;
+    const PackedPosition* records = nullptr;
+    size_t count = 0;
+    size_t bufferCapacity;
+    size_t blockSize;
+    std::mt19937_64 rng;
+    std::vector<size_t> blockOrder;
+    size_t nextBlock = 0;
+    size_t cursor = 0;
+    size_t end = 0;
+    std::vector<const PackedPosition*> buffer;
+    std::vector<const PackedPosition*> selected;
+    ThreadPool decoders;
+
+    const PackedPosition* nextIncoming() {
+        if (cursor == end) {
+            if (nextBlock == blockOrder.size()) return nullptr;
+            cursor = blockOrder[nextBlock++];
+            end = std::min(count, cursor + blockSize);
+        }
+        return &records[cursor++];
+    }
+};
@@ -0,0 +1,201 @@
+#pragma once
+#include <ChessBot.h>
+#include <Pruning.h>
+#include <ReplayBuffer.h>
+#include <SelfPlay.h>
+#include <SnapshotPublisher.h>
+#include <algorithm>
+#include <chrono>
+
+struct TrainingSample {
+    ChessBoard board;
+    bool whiteToMove = true;
+    Move move;
+    float outcome = 0.f; // from the mover's side: 1 win, 0 draw, -1 loss
+};
+
+struct PipelineConfig {
+    size_t producers = std::max(2u, std::thread::hardware_concurrency()) - 1;
+    size_t queueCapacity = 1 << 14;
+    size_t windowCapacity = 1 << 17;
+    size_t minWindow = 1024;    // trainer waits until this many positions have arrived
+    size_t batchSize = 32;
+    double learningRate = 0.01;
+    double explorationRate = 0.1; // chance a producer plays a random legal move instead of the bot's
+    size_t publishEvery = 50;   // trained batches between weight publications; 0 never publishes
+    PruningSchedule pruning;    // steps are trained batches
+    uint64_t seed = 0;
+};
+
+// Self-play producers and a trainer running concurrently. Producers play games with the
+// latest published weights and push every position labelled with the final outcome; the
+// trainer samples mini-batches from the replay window and runs backprop on its own copy,
+// publishing it back to the producers every publishEvery batches. Publication swaps in an
+// immutable snapshot (see SnapshotPublisher), so neither side ever waits on the other.
+class TrainingPipeline {
+public:
+    struct Counters {
+        std::atomic<size_t> games{ 0 };
+        std::atomic<size_t> batches{ 0 };
+        std::atomic<size_t> trainedSamples{ 0 };
+        std::atomic<size_t> publications{ 0 };
+    };
+
+    TrainingPipeline(const PipelineConfig& config, const NeuralNetwork& initial)
+        : config(config), buffer(config.queueCapacity, config.windowCapacity), trainerNet(initial), snapshots(initial) {}
+
+    ~TrainingPipeline() {
+        stop();
+    }
+
+    void start() {
+        stopping = false;
+        startTime = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < config.producers; ++i)
+            threads.emplace_back([this, i] { produce(i); });
+        threads.emplace_back([this] { train(); });
+    }
+
+    void stop() {
+        stopping = true;
+        for (auto& thread : threads)
+            thread.join();
+        threads.clear();
+    }
+
+    // Runs the pipeline for the given time, printing throughput every reportInterval seconds
+    void runFor(double seconds, double reportInterval = 1.0) {
+        start();
+        auto end = startTime + std::chrono::duration<double>(seconds);
+        while (std::chrono::steady_clock::now() < end) {
+            auto next = std::min(end, std::chrono::steady_clock::now() + std::chrono::duration<double>(reportInterval));
+            std::this_thread::sleep_until(next);
+            report();
+        }
+        stop();
+    }
+
+    void report() const {
+        double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+        if (elapsed <= 0.0) return;
+        std::cout << "[" << elapsed << "s] "
+                  << counters.games / elapsed << " games/s, "
+                  << buffer.counters.pushed / elapsed << " positions/s produced, "
+                  << counters.trainedSamples / elapsed << " samples/s trained, "
+                  << counters.batches << " batches, "
+                  << buffer.queued() << " queued, "
+                  << buffer.counters.producerWaits << " producer waits, "
+                  << counters.publications << " publications" << std::endl;
+    }
+
+    // The trainer's weights. Only safe to read while the pipeline is stopped.
+    const NeuralNetwork& network() const { return trainerNet; }
+
+    Counters counters;
+
+private:
+    PipelineConfig config;
+    ReplayBuffer<TrainingSample> buffer;
+    NeuralNetwork trainerNet;
+    std::vector<std::thread> threads;
+    std::atomic<bool> stopping{ false };
+    std::chrono::steady_clock::time_point startTime;
+
+    // Producers play each game with the snapshot current at its start
+    SnapshotPublisher<NeuralNetwork> snapshots;
+
+    void publish() {
+        snapshots.publish(trainerNet);
+        counters.publications++;
+    }
+
+    void produce(size_t index) {
+        std::mt19937_64 rng(splitMix64(config.seed + index));
+        std::bernoulli_distribution explore(config.explorationRate);
+        SnapshotPublisher<NeuralNetwork>::Reader reader = snapshots.reader();
+
+        std::vector<TrainingSample> game;
+        std::vector<Move> legalMoves;
+
+        while (!stopping) {
+            auto weights = reader.acquire();
+            const NeuralNetwork& network = *weights;
+
+            game.clear();
+            ChessBoard board;
+            bool whiteTurn = true;
+            std::string result;
+
+            while (!stopping) {
+                result = board.getGameResult(whiteTurn);
+                if (result != "Game continues") break;
+
+                Move move;
+                if (explore(rng)) {
+                    legalMoves.clear();
+                    for (const Coord& from : board.getMovablePieces(whiteTurn))
+                        for (const Coord& to : board.getValidDestinations(from))
+                            legalMoves.push_back({ from, to });
+                    std::uniform_int_distribution<size_t> dist(0, legalMoves.size() - 1);
+                    move = legalMoves[dist(rng)];
+                }
+                else {
+                    // ChessBot::decideMove's path, on the snapshot without copying it into a bot
+                    move = ChessBot::decideFromHidden(network, board, whiteTurn,
+                                                      network.forwardHidden(ChessBot::encodeBoard(board, whiteTurn)), 0);
+                }
+
+                game.push_back({ board, whiteTurn, move, 0.f });
+                board.makeMove(move);
+                whiteTurn = !whiteTurn;
+            }
+            if (stopping) return;
+
+            GameOutcome outcome = outcomeFromResult(result);
+            for (TrainingSample& sample : game) {
+                if (outcome == GameOutcome::WhiteWins) sample.outcome = sample.whiteToMove ? 1.f : -1.f;
+                else if (outcome == GameOutcome::BlackWins) sample.outcome = sample.whiteToMove ? -1.f : 1.f;
+                if (!buffer.push(sample, stopping)) return;
+            }
+            counters.games++;
+        }
+    }
+
+    void train() {
+        std::mt19937_64 rng(splitMix64(~config.seed));
+        std::vector<const TrainingSample*> batch;
+        Matrix target(trainerNet.outputSize, 1);
+
+        while (!stopping) {
+            buffer.drain();
+            if (buffer.windowSize() < std::max<size_t>(config.minWindow, 1)) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                continue;
+            }
+
+            buffer.sample(config.batchSize, rng, batch);
+            for (const TrainingSample* sample : batch) {
+                // Draws carry no signal; wins reinforce the move played, losses push away from it
+                if (sample->outcome == 0.f) continue;
+
+                const Move& move = sample->move;
+                int from = perspectiveSquare(move.from.row * 8 + move.from.col, sample->whiteToMove);
+                int to = perspectiveSquare(move.to.row * 8 + move.to.col, sample->whiteToMove);
+                target.data[from][0] = 0.5f;
+                target.data[64 + to][0] = 0.5f;
+
+                Matrix input = ChessBot::encodeBoard(sample->board, sample->whiteToMove);
+                trainerNet.backprop(input, target, config.learningRate * sample->outcome);
+                counters.trainedSamples++;
+
+                target.data[from][0] = 0.f;
+                target.data[64 + to][0] = 0.f;
+            }
+
+            size_t batches = ++counters.batches;
+            config.pruning.update(trainerNet, batches);
+            if (config.publishEvery && batches % config.publishEvery == 0)
+                publish();
+        }
+    }
+};
@@ -0,0 +1,259 @@
+#pragma once
+#include <Position.h>
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#include <xmmintrin.h>
+#else
+#include <sys/mman.h>
+#endif
+
+enum class Bound : uint8_t { None, Upper, Lower, Exact };
+
+struct TTHit {
+    SquareMove move;
+    bool hasMove = false;
+    int score = 0;
+    int depth = 0;
+    Bound bound = Bound::None;
+};
+
+struct TTStats {
+    uint64_t probes = 0;
+    uint64_t hits = 0;
+    uint64_t stores = 0;
+    uint64_t evictions = 0; // live entries of the current search replaced by a different position
+
+    double hitRate() const { return probes ? (double)hits / probes : 0.0; }
+};
+
+// Shared transposition table of 64-byte buckets holding 4 entries each. Entries are two
+// relaxed 64-bit atomics, the packed data and the key XORed with it, so a read that races a
+// write sees a key mismatch and is treated as a miss instead of returning a torn entry; no
+// locks are needed. Replacement prefers the same position, then empty entries, then the
+// entry with the least depth after penalizing entries left over from earlier searches.
+class TranspositionTable {
+public:
+    explicit TranspositionTable(size_t megabytes = 64) {
+        resize(megabytes);
+    }
+
+    ~TranspositionTable() {
+        release();
+    }
+
+    TranspositionTable(const TranspositionTable&) = delete;
+    TranspositionTable& operator=(const TranspositionTable&) = delete;
+
+    // Rounds down to a power of two buckets. Not safe while searches are running.
+    void resize(size_t megabytes) {
+        release();
+        size_t count = 1;
+        while (count * 2 * sizeof(Bucket) <= std::max<size_t>(megabytes, 1) << 20)
+            count *= 2;
+        allocate(count * sizeof(Bucket));
+        for (size_t i = 0; i < count; ++i)
+            new (&buckets[i]) Bucket();
+        bucketCount = count;
+        clear();
+    }
+
+    void clear() {
+        for (size_t i = 0; i < bucketCount; ++i) {
+            for (Slot& slot : buckets[i].slots) {
+                slot.key.store(0, std::memory_order_relaxed);
+                slot.data.store(0, std::memory_order_relaxed);
+            }
+        }
+        age = 0;
+        for (StatShard& shard : shards) {
+            shard.probes = shard.hits = shard.stores = shard.evictions = 0;
+        }
+    }
+
+    // Call once per root search so older entries become preferred victims
+    void newSearch() {
+        age.store((age.load(std::memory_order_relaxed) + 1) & 63, std::memory_order_relaxed);
+    }
+
+    size_t sizeInBytes() const { return bucketCount * sizeof(Bucket); }
+    bool usesHugePages() const { return hugePages; }
+
+    void prefetch(uint64_t hash) const {
+#ifdef _WIN32
+        _mm_prefetch((const char*)&buckets[hash & (bucketCount - 1)], _MM_HINT_T0);
+#else
+        __builtin_prefetch(&buckets[hash & (bucketCount - 1)]);
+#endif
+    }
+
+    bool probe(uint64_t hash, TTHit& hit) {
+        StatShard& stats = shard();
+        stats.probes.fetch_add(1, std::memory_order_relaxed);
+        const Bucket& bucket = buckets[hash & (bucketCount - 1)];
+        for (const Slot& slot : bucket.slots) {
+            uint64_t data = slot.data.load(std::memory_order_relaxed);
+            uint64_t key = slot.key.load(std::memory_order_relaxed);
+            if ((key ^ data) != hash || boundOf(data) == Bound::None) continue;
+
+            hit.move = { (uint8_t)(data & 63), (uint8_t)((data >> 6) & 63) };
+            hit.hasMove = (data >> 12) & 1;
+            hit.score = (int16_t)(data >> 16);
+            hit.depth = (int)((data >> 32) & 255);
+            hit.bound = boundOf(data);
+            stats.hits.fetch_add(1, std::memory_order_relaxed);
+            return true;
+        }
+        return false;
+    }
+
+    // depth is clamped to 0..255 and score to int16
+    void store(uint64_t hash, SquareMove move, bool hasMove, int score, int depth, Bound bound) {
+        Bucket& bucket = buckets[hash & (bucketCount - 1)];
+        uint8_t currentAge = age.load(std::memory_order_relaxed);
+        Slot* victim = nullptr;
+        int victimWorth = 1 << 30;
+        bool samePosition = false;
+
+        for (Slot& slot : bucket.slots) {
+            uint64_t data = slot.data.load(std::memory_order_relaxed);
+            uint64_t key = slot.key.load(std::memory_order_relaxed);
+            if ((key ^ data) == hash && boundOf(data) != Bound::None) {
+                // Keep a deeper result for the same position unless it's from an old search
+                int oldDepth = (int)((data >> 32) & 255);
+                if (bound != Bound::Exact && depth < oldDepth - 2 && ageOf(data) == currentAge) return;
+                if (!hasMove && ((data >> 12) & 1)) {
+                    move = { (uint8_t)(data & 63), (uint8_t)((data >> 6) & 63) };
+                    hasMove = true;
+                }
+                victim = &slot;
+                samePosition = true;
+                break;
+            }
+
+            int worth = boundOf(data) == Bound::None ? -(1 << 20)
+                      : (int)((data >> 32) & 255) - 8 * (int)((currentAge - ageOf(data)) & 63);
+            if (worth < victimWorth) {
+                victimWorth = worth;
+                victim = &slot;
+            }
+        }
+
+        StatShard& stats = shard();
+        stats.stores.fetch_add(1, std::memory_order_relaxed);
+        if (!samePosition) {
+            uint64_t old = victim->data.load(std::memory_order_relaxed);
+            if (boundOf(old) != Bound::None && ageOf(old) == currentAge)
+                stats.evictions.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        score = std::max(-32767, std::min(32767, score));
+        depth = std::max(0, std::min(255, depth));
+        uint64_t data = (hasMove ? (uint64_t)move.from | ((uint64_t)move.to << 6) | (1ull << 12) : 0) |
+                        ((uint64_t)(uint16_t)(int16_t)score << 16) | ((uint64_t)depth << 32) |
+                        ((uint64_t)bound << 40) | ((uint64_t)currentAge << 42);
+        victim->data.store(data, std::memory_order_relaxed);
+        victim->key.store(hash ^ data, std::memory_order_relaxed);
+    }
+
+    TTStats stats() const {
+        TTStats total;
+        for (const StatShard& shard : shards) {
+            total.probes += shard.probes.load(std::memory_order_relaxed);
+            total.hits += shard.hits.load(std::memory_order_relaxed);
+            total.stores += shard.stores.load(std::memory_order_relaxed);
+            total.evictions += shard.evictions.load(std::memory_order_relaxed);
+        }
+        return total;
+    }
+
+    // Permille of sampled entries written during the current search, as UCI's hashfull
+    int hashfull() const {
+        size_t sample = std::min<size_t>(bucketCount, 250);
+        uint8_t currentAge = age.load(std::memory_order_relaxed);
+        int used = 0;
+        for (size_t i = 0; i < sample; ++i) {
+            for (const Slot& slot : buckets[i].slots) {
+                uint64_t data = slot.data.load(std::memory_order_relaxed);
+                if (boundOf(data) != Bound::None && ageOf(data) == currentAge) used++;
+            }
+        }
+        return (int)(used * 1000 / (sample * 4));
+    }
+
+private:
+    // data: bits 0-11 move, 12 has move, 16-31 score, 32-39 depth, 40-41 bound, 42-47 age
+    struct Slot {
+        std::atomic<uint64_t> key;
+        std::atomic<uint64_t> data;
+    };
+
+    struct alignas(64) Bucket {
+        Slot slots[4];
+    };
+    static_assert(sizeof(Bucket) == 64, "a bucket must fill one cache line");
+
+    // Counters are spread over cache lines by thread so probes don't all contend on one
+    struct alignas(64) StatShard {
+        std::atomic<uint64_t> probes{ 0 };
+        std::atomic<uint64_t> hits{ 0 };
+        std::atomic<uint64_t> stores{ 0 };
+        std::atomic<uint64_t> evictions{ 0 };
+    };
+
+    Bucket* buckets = nullptr;
+    size_t bucketCount = 0;
+    bool hugePages = false;
+    std::atomic<uint8_t> age{ 0 };
+    StatShard shards[16];
+
+    static Bound boundOf(uint64_t data) { return (Bound)((data >> 40) & 3); }
+    static uint8_t ageOf(uint64_t data) { return (uint8_t)((data >> 42) & 63); }
+
+    StatShard& shard() {
+        static std::atomic<unsigned> nextThread{ 0 };
+        thread_local unsigned index = nextThread++ % 16;
+        return shards[index];
+    }
+
+    // Large pages when the OS grants them, which saves a TLB miss on most random probes
+    void allocate(size_t bytes) {
+        hugePages = false;
+#ifdef _WIN32
+        size_t large = GetLargePageMinimum();
+        if (large && bytes % large == 0) {
+            buckets = (Bucket*)VirtualAlloc(nullptr, bytes, MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE);
+            hugePages = buckets != nullptr;
+        }
+        if (!buckets) buckets = (Bucket*)VirtualAlloc(nullptr, bytes, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+#else
+        const size_t hugePage = 2 << 20;
+        size_t rounded = (bytes + hugePage - 1) / hugePage * hugePage;
+        buckets = (Bucket*)std::aligned_alloc(hugePage, rounded);
+#ifdef MADV_HUGEPAGE
+        hugePages = buckets && madvise(buckets, rounded, MADV_HUGEPAGE) == 0;
+#endif
+#endif
+        if (!buckets) throw std::bad_alloc();
+    }
+
+    void release() {
+        if (!buckets) return;
+#ifdef _WIN32
+        VirtualFree(buckets, 0, MEM_RELEASE);
+#else
+        std::free(buckets);
+#endif
+        buckets = nullptr;
+        bucketCount = 0;
+    }
+};
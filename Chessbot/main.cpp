@@ -47,7 +47,15 @@
 #include <string>
 #include <unordered_set>
 #include <ChessBot.h>
+#include <SelfPlay.h>
+#include <Arena.h>
+#include <Tablebase.h>
+#include <GameArchive.h>
+#include <Profiler.h>
+#include <RandomPlayout.h>
 #include <iostream>
+#include <map>
+#include <mutex>
 
 bool writeVectorToFile(const std::vector<std::string>& lines, const std::string& filename) {
     std::ofstream outputFile(filename);
@@ -58,7 +66,9 @@ bool writeVectorToFile(const std::vector<std::string>& lines, const std::string&
         return false;
     }
 
+    PROFILE_SCOPE(ProfileZone::FileIO);
     for (const auto& line : lines) {
+        PROFILE_COUNT(ProfileZone::FileIO, line.size() + 1);
         // Write the current string to the file, followed by a newline character.
         outputFile << line << "\n";
     }
@@ -68,113 +78,39 @@ bool writeVectorToFile(const std::vector<std::string>& lines, const std::string&
 }
 
 void simulateGameAndDumpToFile(int gameNumber) {
-    std::vector<std::string> moveHistory;
-    moveHistory.reserve(500);
-
-    ChessBoard board;
-    // board.printBoard();
-
-    std::mt19937 rng(std::random_device{}());
-    bool whiteTurn = true;
-    int moveCount = 0;
+    thread_local Xoshiro256 rng(std::random_device{}());
+    std::vector<SquareMove> moves;
+    moves.reserve(500);
 
-    while (true) {
-        std::vector<Move> legalMoves;
-
-        // Scan all pieces for current player
-        for (int r = 0; r < 8; ++r) {
-            for (int c = 0; c < 8; ++c) {
-                Piece p = board.getPiece(r, c);
-                if (p == Piece::Empty) continue;
-
-                if ((whiteTurn && p >= Piece::WhitePawn && p <= Piece::WhiteKing) ||
-                    (!whiteTurn && p >= Piece::BlackPawn && p <= Piece::BlackKing)) {
-
-                    Coord from = { r, c };
-                    auto moves = board.getValidMoves(from);
-                    for (int tr = 0; tr < 8; ++tr) {
-                        for (int tc = 0; tc < 8; ++tc) {
-                            if (moves[tr][tc]) {
-                                legalMoves.push_back({ from, {tr, tc} });
-                            }
-                        }
-                    }
-                }
-            }
-        }
+    Position position = Position::startPosition();
+    PlayoutResult playout = randomPlayout(position, rng, &moves);
+    std::cout << playout.result << "\n";
 
-        //if (legalMoves.empty()) {
-        //    std::cout << (whiteTurn ? "Black" : "White") << " wins! No moves left.\n";
-        //    break;
-        //}
-        std::string result = board.getGameResult(whiteTurn);
-        if (result != "Game continues") {
-            std::cout << result << "\n";
-            break;
-        }
-
-        // Choose a random legal move
-        std::uniform_int_distribution<int> dist(0, legalMoves.size() - 1);
-        Move chosen = legalMoves[dist(rng)];
-
-        // Make move
-        std::string move = board.toSAN(chosen.from, chosen.to);
-        //std::cout << move << "\n";
-        moveHistory.push_back(move);
-        board.makeMove(chosen.from, chosen.to);
-        moveCount++;
-        //std::cout << "Move " << moveCount << ": " << (whiteTurn ? "White" : "Black")
-        //    << " moved from (" << chosen.from.row + 1 << "," << char('a' + chosen.from.col)
-        //    << ") to (" << chosen.to.row + 1 << "," << char('a' + chosen.to.col) << ")\n";
-
-        // board.printBoard();
-        whiteTurn = !whiteTurn;
+    // Replay for the move strings since promotions need the moving piece
+    std::vector<std::string> moveHistory;
+    moveHistory.reserve(moves.size());
+    Position replay = Position::startPosition();
+    for (const SquareMove& move : moves) {
+        moveHistory.push_back(replay.toLAN(move));
+        replay.makeMove(move);
     }
 
     writeVectorToFile(moveHistory, "movesets/moveset" + std::to_string(gameNumber) + ".lan");
 }
 
+// Games go to an archive with one shard per worker; GameArchiveReader::exportLAN gives the old per-game files
 void simulateAndDumpNGames(unsigned int gameCount) {
-    for (int i = 0; i < gameCount; i++) {
-        simulateGameAndDumpToFile(i);
-    }
-}
-
-void simulateAndDumpGame2(int gameNumber) {
-    std::mt19937 rng(std::random_device{}());
-    std::uniform_int_distribution<int> dist;
-
-    std::vector<std::string> moveHistory;
-    moveHistory.reserve(500);
-
-    ChessBoard board;
-    bool whiteTurn = true;
-    int moveCount = 0;
-
-    while (true) {
-        std::string result = board.getGameResult(whiteTurn);
-        if(board.getGameResult(whiteTurn) != "Game continues") {
-            std::cout << result << "\n";
-            break;
-        }
-
-        std::vector<Coord> movablePieces = board.getMovablePieces(whiteTurn);
-        dist = std::uniform_int_distribution<int>(0, movablePieces.size() - 1);
-        Coord from = movablePieces[dist(rng)];
-        std::vector<Coord> moveOptions = board.getValidDestinations(from);
-        dist = std::uniform_int_distribution<int>(0, moveOptions.size() - 1);
-        Coord to = moveOptions[dist(rng)];
-
-        std::string move = board.toSAN(from, to);
-        //std::cout << move << "\n";
-        moveHistory.push_back(move);
-        board.makeMove(from, to);
-        moveCount++;
-
-        whiteTurn = !whiteTurn;
-    }
-
-    writeVectorToFile(moveHistory, "movesets/moveset" + std::to_string(gameNumber) + ".lan");
+    SelfPlayConfig config;
+    config.games = gameCount;
+    config.botVsBot = false;
+
+    GameArchiveWriter archive("movesets", std::max<size_t>(config.threads, 1));
+    SelfPlayRunner runner(config);
+    SelfPlayStats stats = runner.run([&](size_t workerIndex, const GameRecord& game) {
+        archive.append(workerIndex, game);
+    });
+    archive.close();
+    stats.print();
 }
 
 void simulateAndDumpNGames2(unsigned int gameCount) {
@@ -184,8 +120,9 @@ void simulateAndDumpNGames2(unsigned int gameCount) {
 }
 
 std::string simulateBotVsBot() {
+    // Both bots play with the same network instance
     ChessBot botA(true);
-    ChessBot botB(false);
+    ChessBot botB(false, botA.chessnet);
 
     std::vector<std::string> moveHistory;
     moveHistory.reserve(500);
@@ -222,14 +159,30 @@ std::string simulateBotVsBot() {
 }
 
 int main() {
-    for (int i = 0; i < 300; i++) {
-        std::string outcome = simulateBotVsBot();
-        assert(outcome == "Draw (50-move rule)");
-        if (outcome != "Draw (50-move rule)") {
-            std::cout << "took " << i << " games" << std::endl;
-            break;
-        }
-    }
+#ifdef CHESSBOT_PROFILE
+    Profiler::enableTrace(1 << 16);
+    Profiler::startPeriodicReport("profile.json", 5.0);
+#endif
+
+    // Adjudicates covered endgames when TablebaseGen has been run
+    Tablebase tablebase("tablebases");
+    if (tablebase.tableCount() > 0) Tablebase::install(&tablebase);
+
+    ArenaConfig config;
+    config.seed = std::random_device{}();
+
+    NeuralNetwork candidate(772, 128, { 500, 500 }, (unsigned int)config.seed);
+    NeuralNetwork baseline(772, 128, { 500, 500 }, (unsigned int)config.seed + 1);
+
+    Arena arena(config, candidate, baseline);
+    ArenaResult result = arena.run();
+    result.print();
+
+#ifdef CHESSBOT_PROFILE
+    Profiler::stopPeriodicReport();
+    Profiler::writeJSON(std::cout);
+    Profiler::writeChromeTrace("profile.trace.json");
+#endif
 
     return 0;
 }
@@ -0,0 +1,150 @@
+// Local inference server. Loads one network and evaluates positions for any number of clients
+// on the same host over a Unix domain socket, batching their requests (see InferenceServer).
+//
+// --clients N runs a load test instead of serving: N client threads evaluate positions through
+// the server for --seconds, then the same N threads each with a private copy of the network,
+// and both aggregate rates are printed.
+//
+// usage: inferenceserver [--socket PATH] [--batch N] [--latency-ms X] [--threads N] [--seed S]
+//                        [--write-timeout-ms X] [--prune SPARSITY] [--clients N] [--seconds S]
+//   Defaults: --socket /tmp/chessbot-inference.sock --batch 32 --latency-ms 1 --threads <cores>
+//   --write-timeout-ms 1000 --seconds 5. Serves until stdin closes or reads "quit".
+
+#include <InferenceServer.h>
+#include <Position.h>
+#include <Random.h>
+#include <Search.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifndef _WIN32
+struct ServerOptions {
+    std::string socket = "/tmp/chessbot-inference.sock";
+    InferenceConfig config;
+    unsigned int seed = 0;
+    double prune = 0.0;
+    size_t clients = 0;
+    double seconds = 5.0;
+};
+
+// Encoded positions from random games, one per column
+Matrix loadTestInputs(size_t count) {
+    Matrix inputs(772, count);
+    Xoshiro256 rng(1);
+    Position position = Position::startPosition();
+    MoveList moves;
+    for (size_t j = 0; j < count; ++j) {
+        position.generateLegal(moves);
+        if (moves.size == 0 || position.gameResult() != std::string("Game continues")) {
+            position = Position::startPosition();
+            position.generateLegal(moves);
+        }
+        position.makeMove(moves[rng.below(moves.size)]);
+        Search::encode(position, inputs, j);
+    }
+    return inputs;
+}
+
+// Positions per second over all clients, each evaluating one position at a time with evaluate
+template<typename Evaluate>
+double measureClients(size_t clients, double seconds, const Matrix& inputs, Evaluate evaluate) {
+    std::atomic<size_t> evaluated{ 0 };
+    std::atomic<bool> stopping{ false };
+    std::vector<std::thread> threads;
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < clients; ++i) {
+        threads.emplace_back([&, i] {
+            size_t done = 0;
+            for (size_t j = i; !stopping; j = (j + clients) % inputs.cols, ++done) {
+                if (!evaluate(i, inputs.column(j))) break;
+            }
+            evaluated += done;
+        });
+    }
+    std::this_thread::sleep_for(std::chrono::duration<double>(seconds));
+    stopping = true;
+    for (auto& thread : threads)
+        thread.join();
+    return evaluated / std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+int runLoadTest(const ServerOptions& options, const NeuralNetwork& network) {
+    Matrix inputs = loadTestInputs(1024);
+    double served, local;
+    size_t batches, samples;
+    {
+        InferenceServer server(options.socket, network, options.config);
+        if (!server.isOpen()) return 1;
+        server.start();
+        std::vector<std::unique_ptr<InferenceClient>> clients;
+        for (size_t i = 0; i < options.clients; ++i) {
+            clients.emplace_back(new InferenceClient(options.socket));
+            if (!clients.back()->isOpen()) return 1;
+        }
+        served = measureClients(options.clients, options.seconds, inputs, [&](size_t i, const Matrix& input) {
+            return clients[i]->forward(input).rows > 0;
+        });
+        server.stop();
+        batches = server.counters().batches;
+        samples = server.counters().samples;
+    }
+
+    std::vector<NeuralNetwork> copies(options.clients, network);
+    local = measureClients(options.clients, options.seconds, inputs, [&](size_t i, const Matrix& input) {
+        return copies[i].forward(input).rows > 0;
+    });
+
+    std::cout << "server: " << served << " positions/s from " << options.clients << " clients, mean batch "
+              << (batches ? (double)samples / batches : 0.0) << ", one network of "
+              << network.inferenceWeightBytes() << " weight bytes" << std::endl;
+    std::cout << "private networks: " << local << " positions/s, " << options.clients << " networks of "
+              << network.inferenceWeightBytes() << " weight bytes" << std::endl;
+    return 0;
+}
+#endif
+
+int main(int argc, char** argv) {
+#ifdef _WIN32
+    std::cerr << "Error: inferenceserver needs Unix domain sockets" << std::endl;
+    return 1;
+#else
+    ServerOptions options;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--socket" && i + 1 < argc) options.socket = argv[++i];
+        else if (arg == "--batch" && i + 1 < argc) options.config.maxBatch = std::max<size_t>(std::stoul(argv[++i]), 1);
+        else if (arg == "--latency-ms" && i + 1 < argc) options.config.maxLatencyMillis = std::stod(argv[++i]);
+        else if (arg == "--threads" && i + 1 < argc) options.config.threads = std::max<size_t>(std::stoul(argv[++i]), 1);
+        else if (arg == "--write-timeout-ms" && i + 1 < argc) options.config.writeTimeoutMillis = std::stod(argv[++i]);
+        else if (arg == "--seed" && i + 1 < argc) options.seed = (unsigned int)std::stoul(argv[++i]);
+        else if (arg == "--prune" && i + 1 < argc) options.prune = std::stod(argv[++i]);
+        else if (arg == "--clients" && i + 1 < argc) options.clients = std::stoul(argv[++i]);
+        else if (arg == "--seconds" && i + 1 < argc) options.seconds = std::stod(argv[++i]);
+        else {
+            std::cerr << "Error: unknown argument '" << arg << "'" << std::endl;
+            return 2;
+        }
+    }
+
+    NeuralNetwork network(772, 128, { 500, 500 }, options.seed);
+    if (options.prune > 0.0) network.prune(options.prune);
+    if (options.clients > 0) return runLoadTest(options, network);
+
+    InferenceServer server(options.socket, network, options.config);
+    if (!server.isOpen()) return 1;
+    server.start();
+    std::cout << "Serving on " << options.socket << std::endl;
+
+    std::string line;
+    while (std::getline(std::cin, line) && line != "quit") {}
+    server.stop();
+    std::cout << server.counters().requests << " requests, " << server.counters().samples << " positions in "
+              << server.counters().batches << " batches (mean " << server.meanBatchSize() << ")" << std::endl;
+    return 0;
+#endif
+}
@@ -0,0 +1,200 @@
+// Multi-process self-play on one host. The coordinator puts the network weights in POSIX shared
+// memory, forks the worker processes and collects their finished games over a Unix domain
+// socket, optionally into a game archive. Workers map the weights read-only and pick up every
+// publication between batches of games.
+//
+// --replicas N keeps N copies of the weights; worker i reads copy i % N, so with workers pinned
+// per NUMA node (e.g. numactl --cpunodebind) each node can read a local copy. --workers 0
+// starts no workers and waits for ones launched by hand with --worker.
+//
+// Every game opens with --opening-plies random legal moves drawn from its seed, which differs per
+// worker, round and game; that's what keeps games of the same weights apart, as the players
+// themselves are deterministic. With 0 every game between two publications is the same.
+//
+// --adjudicate ends games early with the default AdjudicationConfig: a side that stays behind on
+// material resigns, and a long enough level stretch is declared drawn. A sample of games is played
+// out anyway with the verdict recorded, so false adjudications can be counted. Off by default, so
+// games end by the rules alone; workers launched by hand need it too.
+//
+// usage: selfplayhost [--workers N] [--games N] [--batch N] [--replicas N] [--publish-every N]
+//                     [--opening-plies N] [--seed S] [--adjudicate] [--out DIR]
+//        selfplayhost --worker INDEX --weights NAME --socket PATH [--batch N] [--opening-plies N] [--seed S]
+//                     [--adjudicate]
+//   --publish-every N publishes freshly initialized weights every N games, standing in for a
+//   trainer. Defaults: --workers <cores> --games 100 --batch 8 --replicas 1 --opening-plies 8.
+
+#include <GameArchive.h>
+#include <GameStream.h>
+#include <SelfPlay.h>
+#include <SharedWeights.h>
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifndef _WIN32
+#include <sys/wait.h>
+#include <unistd.h>
+
+struct HostOptions {
+    size_t workers = std::max(1u, std::thread::hardware_concurrency());
+    size_t games = 100;
+    size_t batch = 8;
+    size_t replicas = 1;
+    size_t publishEvery = 0;
+    size_t openingPlies = SelfPlayConfig().openingPlies;
+    uint64_t seed = 0;
+    bool adjudicate = false;
+    std::string out;
+    // Worker mode
+    long worker = -1;
+    std::string weights;
+    std::string socket;
+};
+
+// Plays batches of lockstep games with the newest shared weights until the coordinator asks
+// the workers to stop
+int runWorker(const HostOptions& options) {
+    SharedWeights weights(options.weights);
+    GameStreamClient stream(options.socket);
+    if (!weights.isOpen() || !stream.isOpen()) return 1;
+
+    NeuralNetwork network = weights.makeNetwork();
+    uint64_t version = weights.version();
+    bool connected = true;
+
+    for (uint64_t round = 0; connected && !weights.shutdownRequested(); ++round) {
+        if (weights.version() != version) version = weights.read(network);
+
+        SelfPlayConfig config;
+        config.threads = 1;
+        config.games = options.batch;
+        config.lockstepGames = options.batch;
+        config.openingPlies = options.openingPlies;
+        config.seed = SelfPlayRunner::gameSeed(options.seed, ((uint64_t)options.worker << 32) | round);
+        config.adjudication.enabled = options.adjudicate;
+
+        SelfPlayRunner runner(config, network);
+        runner.run([&](size_t, const GameRecord& game) {
+            connected = connected && stream.send(game);
+        });
+    }
+    return 0;
+}
+
+int runCoordinator(const HostOptions& options) {
+    std::string prefix = "/chessbot-" + std::to_string(getpid());
+    std::string socketPath = "/tmp" + prefix + ".sock";
+
+    NeuralNetwork network(772, 128, { 500, 500 }, (unsigned int)options.seed);
+    std::vector<std::unique_ptr<SharedWeights>> replicas;
+    for (size_t i = 0; i < std::max<size_t>(options.replicas, 1); ++i) {
+        replicas.emplace_back(new SharedWeights(prefix + "-weights" + std::to_string(i), network));
+        if (!replicas.back()->isOpen()) return 1;
+    }
+    GameStreamServer server(socketPath);
+    if (!server.isOpen()) return 1;
+
+    // Fork before anything starts a thread
+    std::vector<pid_t> children;
+    for (size_t i = 0; i < options.workers; ++i) {
+        pid_t pid = fork();
+        if (pid == 0) {
+            HostOptions worker = options;
+            worker.worker = (long)i;
+            worker.weights = prefix + "-weights" + std::to_string(i % replicas.size());
+            worker.socket = socketPath;
+            _exit(runWorker(worker));
+        }
+        if (pid < 0) {
+            std::cerr << "Error: Could not start worker " << i << std::endl;
+            break;
+        }
+        children.push_back(pid);
+    }
+    if (options.workers == 0) {
+        std::cout << "Waiting for workers: --weights " << prefix << "-weights<N> --socket " << socketPath << std::endl;
+    }
+
+    std::unique_ptr<GameArchiveWriter> archive(options.out.empty() ? nullptr : new GameArchiveWriter(options.out, 1));
+    size_t received = 0, plies = 0, publications = 0;
+    auto onGame = [&](const GameRecord& game) {
+        // Numbered in arrival order; the seed still identifies the game
+        GameRecord numbered = game;
+        numbered.index = received++;
+        plies += game.moves.size();
+        if (archive) archive->append(0, numbered);
+    };
+
+    auto start = std::chrono::steady_clock::now();
+    while (received < options.games) {
+        size_t before = received;
+        server.poll(100, onGame);
+        if (options.publishEvery && received / options.publishEvery > before / options.publishEvery) {
+            network.initialize((unsigned int)(options.seed + ++publications));
+            for (auto& replica : replicas)
+                replica->publish(network);
+        }
+
+        // Give up when every forked worker has died
+        for (size_t i = children.size(); i-- > 0;) {
+            if (waitpid(children[i], nullptr, WNOHANG) == children[i]) children.erase(children.begin() + i);
+        }
+        if (options.workers > 0 && children.empty() && server.clientCount() == 0) {
+            std::cerr << "Error: All workers exited" << std::endl;
+            break;
+        }
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    size_t timedGames = received;
+
+    // Workers stop after their current batch; their last games are still collected
+    for (auto& replica : replicas)
+        replica->requestShutdown();
+    while (!children.empty() || server.clientCount() > 0) {
+        server.poll(100, onGame);
+        for (size_t i = children.size(); i-- > 0;) {
+            if (waitpid(children[i], nullptr, WNOHANG) == children[i]) children.erase(children.begin() + i);
+        }
+        if (options.workers == 0 && server.clientCount() == 0) break;
+    }
+    if (archive) archive->close();
+
+    std::cout << received << " games, " << plies << " plies in " << seconds << "s ("
+              << (seconds > 0.0 ? timedGames / seconds : 0.0) << " games/s) from "
+              << options.workers << " workers, " << publications << " publications" << std::endl;
+    return timedGames >= options.games ? 0 : 1;
+}
+#endif
+
+int main(int argc, char** argv) {
+#ifdef _WIN32
+    std::cerr << "Error: selfplayhost needs POSIX shared memory and Unix domain sockets" << std::endl;
+    return 1;
+#else
+    HostOptions options;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--workers" && i + 1 < argc) options.workers = std::stoul(argv[++i]);
+        else if (arg == "--games" && i + 1 < argc) options.games = std::stoul(argv[++i]);
+        else if (arg == "--batch" && i + 1 < argc) options.batch = std::max<size_t>(std::stoul(argv[++i]), 1);
+        else if (arg == "--replicas" && i + 1 < argc) options.replicas = std::stoul(argv[++i]);
+        else if (arg == "--publish-every" && i + 1 < argc) options.publishEvery = std::stoul(argv[++i]);
+        else if (arg == "--opening-plies" && i + 1 < argc) options.openingPlies = std::stoul(argv[++i]);
+        else if (arg == "--seed" && i + 1 < argc) options.seed = std::stoull(argv[++i]);
+        else if (arg == "--adjudicate") options.adjudicate = true;
+        else if (arg == "--out" && i + 1 < argc) options.out = argv[++i];
+        else if (arg == "--worker" && i + 1 < argc) options.worker = std::stol(argv[++i]);
+        else if (arg == "--weights" && i + 1 < argc) options.weights = argv[++i];
+        else if (arg == "--socket" && i + 1 < argc) options.socket = argv[++i];
+        else {
+            std::cerr << "Error: unknown argument '" << arg << "'" << std::endl;
+            return 2;
+        }
+    }
+    return options.worker >= 0 ? runWorker(options) : runCoordinator(options);
+#endif
+}
@@ -0,0 +1,43 @@
+// Endgame tablebase generator. Builds every table with up to --max-pieces pieces (kings
+// included, at most 4) into the output directory, smallest first. Tables already present there
+// are loaded instead of rebuilt, so an interrupted run can be resumed.
+//
+// usage: tbgen [--max-pieces N] [--out DIR]
+//   Defaults: --max-pieces 4 --out tablebases
+
+#include <Tablebase.h>
+#include <TablebaseGenerator.h>
+#include <filesystem>
+#include <iostream>
+#include <string>
+
+int main(int argc, char** argv) {
+    int maxPieces = Tablebase::MaxPieces;
+    std::string directory = "tablebases";
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--max-pieces" && i + 1 < argc) maxPieces = std::stoi(argv[++i]);
+        else if (arg == "--out" && i + 1 < argc) directory = argv[++i];
+        else {
+            std::cerr << "Error: unknown argument '" << arg << "'" << std::endl;
+            return 2;
+        }
+    }
+
+    std::filesystem::create_directories(directory);
+    Tablebase tablebase;
+    size_t existing = tablebase.load(directory);
+    if (existing) std::cout << "Loaded " << existing << " existing tables from " << directory << std::endl;
+
+    TablebaseGenerator generator(tablebase);
+    for (uint32_t material : TablebaseGenerator::materials(maxPieces)) {
+        if (tablebase.has(material)) continue;
+        TablebaseBuildStats stats = generator.generate(material);
+        stats.print();
+
+        std::string path = (std::filesystem::path(directory) / (stats.name + ".cbtb")).string();
+        if (!tablebase.write(material, path)) return 1;
+    }
+    std::cout << "Successfully wrote tablebases to " << directory << std::endl;
+    return 0;
+}
@@ -0,0 +1,249 @@
+// UCI front end. Reads commands on stdin and plays with Search over the bot's network, or with
+// a single greedy forward pass when UsePolicy is set. Decisions run on an AsyncPlayer so stop,
+// ponderhit, isready and quit are answered while thinking.
+//
+// Supported: uci, isready, ucinewgame, setoption, position (startpos | fen ...) [moves ...],
+// go [ponder wtime btime winc binc movestogo movetime nodes depth infinite], stop, ponderhit, quit,
+// and d to print the current FEN. Castling, en passant and underpromotion don't exist in this
+// variant, so moves using them are rejected.
+
+#include <AsyncPlayer.h>
+#include <ChessBot.h>
+#include <Search.h>
+#include <Tablebase.h>
+#include <TimeManager.h>
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+
+class UciEngine {
+public:
+    UciEngine() : network(std::make_shared<NeuralNetwork>(772, 128, std::vector<size_t>{ 500, 500 }, 0)), player(network, 64),
+                  position(Position::startPosition()) {}
+
+    ~UciEngine() {
+        player.stop();
+    }
+
+    void run(std::istream& in) {
+        std::string line;
+        while (std::getline(in, line)) {
+            std::istringstream tokens(line);
+            std::string command;
+            tokens >> command;
+
+            if (command == "uci") {
+                send("id name Chessbot");
+                send("id author TannerLow");
+                send("option name Hash type spin default 64 min 1 max 65536");
+                send("option name Move Overhead type spin default 30 min 0 max 5000");
+                send("option name Ponder type check default false");
+                send("option name Seed type spin default 0 min 0 max 2147483647");
+                send("option name TablebasePath type string default <empty>");
+                send("option name UsePolicy type check default false");
+                send("uciok");
+            }
+            else if (command == "isready") send("readyok");
+            else if (command == "ucinewgame") {
+                player.clear();
+                position = Position::startPosition();
+            }
+            else if (command == "setoption") setOption(tokens);
+            else if (command == "position") setPosition(tokens);
+            else if (command == "go") go(tokens);
+            else if (command == "stop") player.stop();
+            else if (command == "ponderhit") player.ponderHit(); // keeps searching under the go ponder limits, timed from now
+            else if (command == "d") send(position.toFEN());
+            else if (command == "quit") break;
+            else if (!command.empty()) send("info string Unknown command: " + command);
+        }
+        player.stop();
+    }
+
+private:
+    std::shared_ptr<NeuralNetwork> network;
+    AsyncPlayer player; // prints bestmove when a decision is released
+    std::unique_ptr<Tablebase> tablebase;
+    TimeManager timeManager;
+    Position position;
+    bool usePolicy = false;
+
+    std::mutex outputMutex;
+
+    void send(const std::string& line) {
+        std::lock_guard<std::mutex> lock(outputMutex);
+        std::cout << line << std::endl;
+    }
+
+    void setOption(std::istringstream& tokens) {
+        std::string token, name, value;
+        tokens >> token; // "name"
+        while (tokens >> token && token != "value")
+            name += (name.empty() ? "" : " ") + token;
+        std::getline(tokens >> std::ws, value);
+
+        player.stop();
+        long number;
+        if (name == "Hash") {
+            if (parseSpin(name, value, 1, 65536, number)) player.transpositionTable().resize((size_t)number);
+        }
+        else if (name == "Move Overhead") {
+            if (parseSpin(name, value, 0, 5000, number)) timeManager.moveOverhead = (double)number;
+        }
+        else if (name == "Seed") {
+            if (parseSpin(name, value, 0, 2147483647, number)) network->initialize((unsigned int)number);
+        }
+        else if (name == "UsePolicy") usePolicy = value == "true";
+        else if (name == "Ponder") {} // the GUI decides when to send go ponder
+        else if (name == "TablebasePath") {
+            Tablebase::install(nullptr);
+            tablebase.reset();
+            if (value.empty() || value == "<empty>") return;
+            tablebase.reset(new Tablebase(value));
+            size_t loaded = tablebase->tableCount();
+            if (loaded) Tablebase::install(tablebase.get());
+            send("info string Loaded " + std::to_string(loaded) + " tablebases from " + value);
+        }
+        else send("info string Unknown option: " + name);
+    }
+
+    // A spin option's value, in the range the uci command declares; otherwise says why and
+    // returns false, leaving the option as it was
+    bool parseSpin(const std::string& name, const std::string& value, long min, long max, long& number) {
+        size_t used = 0;
+        try {
+            number = std::stol(value, &used);
+        }
+        catch (const std::logic_error&) {
+            used = 0;
+        }
+        if (used == 0 || used != value.size() || number < min || number > max) {
+            send("info string Invalid value for " + name + ": '" + value + "', expected " + std::to_string(min) +
+                 " to " + std::to_string(max));
+            return false;
+        }
+        return true;
+    }
+
+    void setPosition(std::istringstream& tokens) {
+        std::string token;
+        tokens >> token;
+        Position parsed;
+        if (token == "startpos") {
+            parsed = Position::startPosition();
+            tokens >> token;
+        }
+        else if (token == "fen") {
+            std::string fen;
+            while (tokens >> token && token != "moves")
+                fen += (fen.empty() ? "" : " ") + token;
+            if (!Position::fromFEN(fen, parsed)) {
+                send("info string Invalid FEN: " + fen);
+                return;
+            }
+        }
+        else {
+            send("info string Expected startpos or fen");
+            return;
+        }
+
+        if (token == "moves") {
+            while (tokens >> token) {
+                SquareMove move;
+                if (!parsed.parseLAN(token, move)) {
+                    send("info string Illegal move: " + token);
+                    break;
+                }
+                parsed.makeMove(move);
+            }
+        }
+        player.stop();
+        position = parsed;
+    }
+
+    void go(std::istringstream& tokens) {
+        GoParameters parameters;
+        bool ponder = false;
+        std::string token;
+        while (tokens >> token) {
+            if (token == "wtime") tokens >> parameters.whiteTime;
+            else if (token == "btime") tokens >> parameters.blackTime;
+            else if (token == "winc") tokens >> parameters.whiteIncrement;
+            else if (token == "binc") tokens >> parameters.blackIncrement;
+            else if (token == "movestogo") tokens >> parameters.movesToGo;
+            else if (token == "movetime") tokens >> parameters.moveTime;
+            else if (token == "nodes") tokens >> parameters.nodes;
+            else if (token == "depth") tokens >> parameters.depth;
+            else if (token == "infinite") parameters.infinite = true;
+            else if (token == "ponder") ponder = true;
+        }
+
+        SearchLimits limits = timeManager.allocate(parameters, position.whiteToMove);
+        DecisionOptions options;
+        // UCI forbids bestmove before stop in infinite mode; the player itself holds a ponder's
+        // result until ponderhit or stop
+        options.holdUntilCancelled = parameters.infinite;
+        options.onIteration = [this, root = position](const SearchResult& result) { send(infoLine(root, result)); };
+        options.onDecided = [this, root = position](const SearchResult& result) { send(bestMoveLine(root, result)); };
+        if (usePolicy) {
+            options.decide = [this](const Position& root) {
+                SearchResult result;
+                result.hasMove = decideWithPolicy(root, result.bestMove);
+                return result;
+            };
+        }
+        if (ponder) player.ponderAsync(position, limits, options);
+        else player.decideAsync(position, limits, options);
+    }
+
+    static std::string bestMoveLine(const Position& root, const SearchResult& result) {
+        std::string line = "bestmove " + (result.hasMove ? root.toLAN(result.bestMove) : std::string("0000"));
+        if (result.pv.size() >= 2) {
+            Position next = root;
+            next.makeMove(result.pv[0]);
+            line += " ponder " + next.toLAN(result.pv[1]);
+        }
+        return line;
+    }
+
+    bool decideWithPolicy(Position root, SquareMove& best) {
+        MoveList legal;
+        root.generateLegal(legal);
+        if (legal.size == 0) return false;
+        auto start = std::chrono::steady_clock::now();
+        ChessBot bot(root.whiteToMove, network);
+        best = SquareMove::fromMove(bot.decideMove(root.toChessBoard()));
+        long millis = (long)std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        send("info depth 1 nodes 1 time " + std::to_string(millis));
+        return true;
+    }
+
+    static std::string infoLine(Position root, const SearchResult& result) {
+        std::string line = "info depth " + std::to_string(result.depth) + " score ";
+        if (std::abs(result.score) >= Search::MateScore - Search::MaxPly) {
+            int plies = Search::MateScore - std::abs(result.score);
+            line += "mate " + std::to_string(result.score > 0 ? (plies + 1) / 2 : -(plies + 1) / 2);
+        }
+        else line += "cp " + std::to_string(result.score);
+
+        uint64_t nps = result.seconds > 0.0 ? (uint64_t)(result.nodes / result.seconds) : 0;
+        line += " nodes " + std::to_string(result.nodes) + " nps " + std::to_string(nps) +
+                " time " + std::to_string((long)(result.seconds * 1000.0)) + " pv";
+        for (const SquareMove& move : result.pv) {
+            line += " " + root.toLAN(move);
+            root.makeMove(move);
+        }
+        return line;
+    }
+};
+
+int main() {
+    std::ios::sync_with_stdio(false);
+    UciEngine engine;
+    engine.run(std::cin);
+    return 0;
+}
@@ -0,0 +1,247 @@
+// Bulk game verifier. Replays .lan files and game archives in parallel through Position's
+// move generator and, unless --no-crosscheck is given, compares the full legal move set of
+// every position with ChessBoard::getValidMoves. Every divergence is reported, not just the
+// first one.
+//
+// usage: verifier [--threads N] [--no-crosscheck] [--max-report N] [--tablebase DIR] [path...]
+//   path is a .lan file, a directory of .lan files, or an archive directory (shard0.games).
+//   Defaults to movesets/. --tablebase is needed for games that were adjudicated by one.
+
+#include <Adjudication.h>
+#include <Position.h>
+#include <GameArchive.h>
+#include <MappedFile.h>
+#include <ThreadPool.h>
+#include <Tablebase.h>
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <chrono>
+#include <filesystem>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+struct Divergence {
+    std::string source;
+    size_t ply;
+    std::string kind;
+    std::string fen;
+    std::string detail;
+};
+
+struct VerifyOptions {
+    size_t threads = std::thread::hardware_concurrency();
+    bool crossCheck = true;
+    size_t maxReport = 100;
+};
+
+struct WorkerTotals {
+    std::vector<Divergence> divergences;
+    size_t games = 0;
+    size_t plies = 0;
+    size_t positionsCrossChecked = 0;
+};
+
+std::string moveToStr(const SquareMove& move) {
+    ChessBoard board;
+    Move m = move.toMove();
+    return board.coordToStr(m.from) + board.coordToStr(m.to);
+}
+
+// Compares every legal move of the side to move between Position and ChessBoard
+void crossCheck(Position& position, const std::string& source, size_t ply, WorkerTotals& totals) {
+    MoveList reference;
+    position.generateLegal(reference);
+    std::array<std::array<bool, 64>, 64> expected = {};
+    for (const SquareMove& move : reference)
+        expected[move.from][move.to] = true;
+
+    ChessBoard board = position.toChessBoard();
+    std::string extra, missing;
+    for (int from = 0; from < 64; ++from) {
+        Piece p = position.squares[from];
+        std::array<std::array<bool, 8>, 8> actual = {};
+        if (Position::isColor(p, position.whiteToMove))
+            actual = board.getValidMoves({ from / 8, from % 8 });
+
+        for (int to = 0; to < 64; ++to) {
+            bool got = actual[to / 8][to % 8];
+            if (got == expected[from][to]) continue;
+            std::string move = moveToStr({ (uint8_t)from, (uint8_t)to });
+            (got ? extra : missing) += " " + move;
+        }
+    }
+
+    totals.positionsCrossChecked++;
+    if (!extra.empty())
+        totals.divergences.push_back({ source, ply, "ChessBoard allows illegal moves", position.toFEN(), extra });
+    if (!missing.empty())
+        totals.divergences.push_back({ source, ply, "ChessBoard misses legal moves", position.toFEN(), missing });
+}
+
+// result is null when the source doesn't record one (.lan files)
+void verifyGame(const std::string& source, const std::vector<SquareMove>& moves, const std::string* result,
+                const VerifyOptions& options, WorkerTotals& totals) {
+    Position position = Position::startPosition();
+    MoveList legal;
+    totals.games++;
+
+    for (size_t ply = 0; ply < moves.size(); ++ply) {
+        if (options.crossCheck)
+            crossCheck(position, source, ply, totals);
+
+        std::string status = position.gameResult();
+        if (status != "Game continues") {
+            totals.divergences.push_back({ source, ply, "move after game end", position.toFEN(),
+                                           status + ", next move " + moveToStr(moves[ply]) });
+            return;
+        }
+
+        position.generateLegal(legal);
+        if (!legal.contains(moves[ply])) {
+            totals.divergences.push_back({ source, ply, "illegal move", position.toFEN(), moveToStr(moves[ply]) });
+            return;
+        }
+
+        position.makeMove(moves[ply]);
+        totals.plies++;
+    }
+
+    if (options.crossCheck)
+        crossCheck(position, source, moves.size(), totals);
+
+    std::string status = position.gameResult();
+    // Resignations and adjudicated draws end games the rules would continue
+    bool adjudicated = result && status == "Game continues" && Adjudication::isVerdict(*result);
+    if (result && status != *result && !adjudicated) {
+        totals.divergences.push_back({ source, moves.size(), "result mismatch", position.toFEN(),
+                                       "recorded '" + *result + "', reference '" + status + "'" });
+    }
+    else if (status == "Game continues" && !adjudicated) {
+        totals.divergences.push_back({ source, moves.size(), "game not finished", position.toFEN(), "" });
+    }
+}
+
+void verifyLanFile(const std::string& path, const VerifyOptions& options, WorkerTotals& totals) {
+    MappedFile file(path);
+    std::vector<SquareMove> moves;
+    const char* text = reinterpret_cast<const char*>(file.data());
+    size_t size = file.size();
+
+    for (size_t i = 0; i < size;) {
+        size_t end = i;
+        while (end < size && text[end] != '\n') end++;
+        std::string line(text + i, end - i);
+        i = end + 1;
+
+        line.erase(std::remove_if(line.begin(), line.end(), [](char c) { return std::isspace((unsigned char)c); }), line.end());
+        if (line.empty()) continue;
+
+        bool valid = (line.size() == 4 || (line.size() == 5 && line[4] == 'q'));
+        for (int k = 0; valid && k < 4; k += 2)
+            valid = line[k] >= 'a' && line[k] <= 'h' && line[k + 1] >= '1' && line[k + 1] <= '8';
+        if (!valid) {
+            totals.divergences.push_back({ path, moves.size(), "unparseable move", "", line });
+            return;
+        }
+        moves.push_back({ (uint8_t)((line[1] - '1') * 8 + (line[0] - 'a')), (uint8_t)((line[3] - '1') * 8 + (line[2] - 'a')) });
+    }
+
+    verifyGame(path, moves, nullptr, options, totals);
+}
+
+int main(int argc, char** argv) {
+    VerifyOptions options;
+    std::vector<std::string> paths;
+    Tablebase tablebase;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--threads" && i + 1 < argc) options.threads = std::stoul(argv[++i]);
+        else if (arg == "--no-crosscheck") options.crossCheck = false;
+        else if (arg == "--max-report" && i + 1 < argc) options.maxReport = std::stoul(argv[++i]);
+        else if (arg == "--tablebase" && i + 1 < argc) {
+            std::string directory = argv[++i];
+            if (tablebase.load(directory) == 0) std::cerr << "Error: No tablebases found in '" << directory << "'" << std::endl;
+        }
+        else paths.push_back(arg);
+    }
+    if (tablebase.tableCount() > 0) Tablebase::install(&tablebase);
+    if (paths.empty()) paths.push_back("movesets");
+
+    ThreadPool pool(options.threads);
+    std::vector<WorkerTotals> totals(pool.size());
+    std::vector<std::unique_ptr<GameArchiveReader>> archives;
+    auto start = std::chrono::steady_clock::now();
+
+    for (const std::string& path : paths) {
+        if (std::filesystem::is_directory(path) && std::filesystem::exists(archiveShardPath(path, 0))) {
+            archives.emplace_back(new GameArchiveReader(path));
+            const GameArchiveReader& archive = *archives.back();
+            const size_t chunk = 256;
+            for (size_t first = 0; first < archive.gameCount(); first += chunk) {
+                pool.submit([&archive, &options, &totals, path, first, chunk](size_t worker) {
+                    std::vector<SquareMove> moves;
+                    size_t last = std::min(archive.gameCount(), first + chunk);
+                    for (size_t n = first; n < last; ++n) {
+                        GameRecord game;
+                        try {
+                            game = archive.game(n);
+                        }
+                        catch (const std::runtime_error&) {
+                            totals[worker].divergences.push_back({ path + "#" + std::to_string(n), 0, "truncated game", "", "" });
+                            continue;
+                        }
+                        moves.clear();
+                        for (const Move& move : game.moves)
+                            moves.push_back(SquareMove::fromMove(move));
+                        verifyGame(path + "#" + std::to_string(n), moves, &game.result, options, totals[worker]);
+                    }
+                });
+            }
+        }
+        else if (std::filesystem::is_directory(path)) {
+            for (const auto& entry : std::filesystem::directory_iterator(path)) {
+                if (!entry.is_regular_file() || entry.path().extension() != ".lan") continue;
+                std::string file = entry.path().string();
+                pool.submit([&options, &totals, file](size_t worker) { verifyLanFile(file, options, totals[worker]); });
+            }
+        }
+        else if (std::filesystem::is_regular_file(path)) {
+            pool.submit([&options, &totals, path](size_t worker) { verifyLanFile(path, options, totals[worker]); });
+        }
+        else {
+            std::cerr << "Error: '" << path << "' not found" << std::endl;
+        }
+    }
+    pool.waitIdle();
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    WorkerTotals all;
+    for (WorkerTotals& worker : totals) {
+        all.games += worker.games;
+        all.plies += worker.plies;
+        all.positionsCrossChecked += worker.positionsCrossChecked;
+        all.divergences.insert(all.divergences.end(), worker.divergences.begin(), worker.divergences.end());
+    }
+    std::sort(all.divergences.begin(), all.divergences.end(), [](const Divergence& a, const Divergence& b) {
+        return a.source != b.source ? a.source < b.source : a.ply < b.ply;
+    });
+
+    for (size_t i = 0; i < all.divergences.size() && i < options.maxReport; ++i) {
+        const Divergence& d = all.divergences[i];
+        std::cout << d.source << " ply " << d.ply << ": " << d.kind;
+        if (!d.detail.empty()) std::cout << ":" << (d.detail[0] == ' ' ? "" : " ") << d.detail;
+        if (!d.fen.empty()) std::cout << " [" << d.fen << "]";
+        std::cout << "\n";
+    }
+    if (all.divergences.size() > options.maxReport)
+        std::cout << "... " << all.divergences.size() - options.maxReport << " more\n";
+
+    std::cout << all.games << " games, " << all.plies << " plies, " << all.positionsCrossChecked
+              << " positions cross-checked in " << seconds << "s (" << (seconds > 0 ? all.plies / seconds : 0.0)
+              << " plies/s), " << all.divergences.size() << " divergences" << std::endl;
+
+    return all.divergences.empty() ? 0 : 1;
+}